@@ -20,6 +20,71 @@
  *                
  *               The buffer method depends on the block mode.(1)(2) 
  *
+ *               Setpoints can be queued with a due time. They are applied
+ *               by the driver timer or on conversion triggers.(1)
+ *
+ *               Channels can be ramped to a target value by the driver.
+ *               A slew limit per channel restricts the steps of M37_Write.(1)
+ *
+ *               Buffered output can be upsampled by the ISR with zero-order
+ *               hold, linear or cubic FIR interpolation.(1)
+ *
+ *               Buffered output data can be delta encoded. It is decoded
+ *               by the ISR.(1)
+ *
+ *               Slow channels of buffered output can be decimated: their
+ *               values are only in the data when they are due.(1)
+ *
+ *               Buffered output can use a lock-free driver ring instead of
+ *               the MBUF library, with a signal when the ring runs low.(1)(2)
+ *
+ *               The status register is cached from the reads of the write
+ *               and interrupt paths. A power supply failure is latched and
+ *               signalled, writes fail immediately until it is restored.(1)
+ *
+ *               Driver events can be recorded in a binary trace ring.(1)
+ *
+ *               Frames can be written to the data registers with two D32
+ *               accesses instead of four D16 accesses (driver variants
+ *               built with M37_D32: m37_d32, byte-swapped m37_sw_d32).(2)
+ *
+ *               The configuration register is kept in a software shadow,
+ *               only changed data registers are written. The bus accesses
+ *               are counted per path.(1)
+ *
+ *               The stream configuration can be set transactionally with
+ *               one block SetStat.(1)
+ *
+ *               A sequencer outputs uploaded waveform segments with
+ *               repeats, links and branches from the ISR.(1)
+ *
+ *               Channels can be owned by different paths, which write
+ *               their channels independently.(1)
+ *
+ *               The committed output can be read back, the last committed
+ *               frames are kept in a history ring.(1)
+ *
+ *               At high interrupt rates the ISR takes the buffered data in
+ *               batches.(1)
+ *
+ *               The ID PROM is read once at init, ID requests are served
+ *               from the cached image.(1)
+ *
+ *               All counters and states can be read as one consistent
+ *               snapshot, optionally resetting the counters.(1)
+ *
+ *               The commits of every Nth frame can be timestamped.(1)
+ *
+ *               The output position of the stream and the queued frames
+ *               can be read atomically.(1)
+ *
+ *               When the power supply to the analog circuit returns after
+ *               a failure, the module is re-initialized in place and the
+ *               output resumes.(1)(2)
+ *
+ *               The lowwater level of the output buffer can adapt itself
+ *               to the reaction time of the refilling application.(1)(2)
+ *
  *                (1) ... definable through status call
  *                (2) ... definable through descriptor key
  *                
@@ -30,6 +95,10 @@
  *
  *     Required: ---
  *     Switches: _ONE_NAMESPACE_PER_DRIVER_
+ *               M37_D32: D32 data register access (ACCESS_D32), the
+ *               address space is requested with MDIS_MD32
+ *               TSTAMP_GET(h), TSTAMP_RATE(h): timestamp source of the
+ *               commit timestamps (default: system tick, 1..10 msec)
  *
  *---------------------------------------------------------------------------
  * Copyright 2010-2019, MEN Mikro Elektronik GmbH
@@ -77,6 +146,50 @@
 #define MOD_ID_SIZE			128			/* ID PROM size [bytes] */
 #define MOD_ID				0x25		/* ID PROM M-Module ID (0x25 = 37)*/
 #define MOD_ID_N			0x7d25		/* ID PROM M-Module ID for M37N */
+#define SCHED_DEPTH			64			/* schedule queue depth (power of 2) */
+#define SCHED_TIMER_MS		1			/* schedule timer period [msec] */
+#define UPS_MAX				32			/* max. upsampling factor (M37_UPS_MAX) */
+#define UPS_FRAC			14			/* FIR coefficient fraction bits */
+#define RING_CL				64			/* cache line size [bytes] */
+#define STAT_MAXAGE			10			/* default max. status age [msec] */
+#define TRACE_DEPTH			256			/* trace ring size [records] */
+#define BUS_PATHS			5			/* bus access paths (M37_BUS_PATHS) */
+#define SEQ_SEGS			16			/* sequencer segments (M37_SEQ_SEGS) */
+#define SEQ_FRAMES			0x10000		/* max. frames per segment */
+#define HIST_DEPTH			256			/* output history [frames] (M37_HIST_DEPTH) */
+#define PF_UNITS			32			/* units prefetched in batch service */
+#define BATCH_RATE			5000		/* default batch service irq rate [1/s] */
+#define TS_DEPTH			1024		/* timestamp ring [records] (M37_TS_DEPTH) */
+
+/* timestamp source of commit timestamps, can be replaced by a
+   high-resolution counter of the platform (driver switches) */
+#ifndef TSTAMP_GET
+# define TSTAMP_GET(h)		OSS_TickGet((h)->osHdl)
+# define TSTAMP_RATE(h)		OSS_TickRateGet((h)->osHdl)
+#endif
+
+/* record trace event (if enabled), caller holds the irq mask */
+#define TRACE(h,t,a0,a1) \
+	do { if ((h)->trcMask & (1<<(t))) TracePut((h),(t),(a0),(a1)); } while(0)
+/* record trace event (if enabled), from task context without irq mask */
+#define TRACE_LOCKED(h,t,a0,a1) \
+	do { if ((h)->trcMask & (1<<(t))) TracePutLocked((h),(t),(a0),(a1)); } \
+	while(0)
+
+/* counted register access (path llHdl->busPath) */
+#define REG_RD16(h,o) \
+	((h)->busRd[(h)->busPath]++, MREAD_D16((h)->ma,(o)))
+#define REG_WR16(h,o,v) \
+	do { (h)->busWr[(h)->busPath]++; MWRITE_D16((h)->ma,(o),(v)); } while(0)
+#define REG_WR32(h,o,v) \
+	do { (h)->busWr[(h)->busPath]++; MWRITE_D32((h)->ma,(o),(v)); } while(0)
+
+/* memory barrier between ring data and ring index access */
+#ifdef __GNUC__
+# define RING_BARRIER()		__sync_synchronize()
+#else
+# define RING_BARRIER()
+#endif
 
 /* debug settings */
 #define DBG_MYLEVEL			llHdl->dbgLevel
@@ -95,6 +208,11 @@
 #define BUFRDY	0x01	/* STAT_REG: buffer ready */
 #define PWR		0x10	/* STAT_REG: Power supply to analog circuit */
 
+/* D32 data register access (channel pair in one access) */
+#define D32_OFF		0	/* D16 access */
+#define D32_HI		1	/* even channel in upper word */
+#define D32_LO		2	/* even channel in lower word */
+
 /* LOAD_REG bitmask */
 #define TDO		0x01	/* data */
 #define TCK		0x02	/* clock */
@@ -108,6 +226,83 @@
 /*-----------------------------------------+
 |  TYPEDEFS                                |
 +-----------------------------------------*/
+/* setpoint schedule entry */
+typedef struct {
+	u_int32			time;			/* due time */
+	u_int16			mask;			/* channels to update */
+	u_int16			val[CH_NUMBER];	/* channel values */
+} SCHED_ENTRY;
+
+/* lateness of an applied schedule entry */
+typedef struct {
+	u_int32			time;			/* due time */
+	u_int32			late;			/* lateness */
+} SCHED_LATE;
+
+/* trace record */
+typedef struct {
+	u_int32			tick;			/* system tick */
+	u_int32			seq;			/* sequence number */
+	u_int16			type;			/* event */
+	u_int16			arg0;			/* argument 0 */
+	u_int32			arg1;			/* argument 1 */
+} TRACE_REC;
+
+/* committed output frame */
+typedef struct {
+	u_int32			seq;			/* commit number */
+	u_int32			tick;			/* system tick */
+	u_int16			val[CH_NUMBER];	/* values of channels 0..3 */
+} HIST_REC;
+
+/* commit timestamp */
+typedef struct {
+	u_int32			seq;			/* commit number */
+	u_int32			ts;				/* timestamp */
+} TS_REC;
+
+/* channel ramp */
+typedef struct {
+	int32			cur;			/* current value (signed) */
+	int32			target;			/* target value (signed) */
+	u_int32			inc;			/* step per clock tick */
+	u_int32			rem;			/* remainder per clock tick */
+	u_int32			div;			/* remainder divisor */
+	u_int32			acc;			/* remainder accumulator */
+} RAMP;
+
+/* statistics counters (M37_STATS) */
+typedef struct {
+	u_int32			irqs;			/* interrupts */
+	u_int32			commits;		/* frames committed */
+	u_int32			underruns;		/* interrupts with empty buffer */
+	u_int32			pwrFails;		/* power supply failures */
+	u_int32			switches;		/* batch service switches */
+	u_int32			saved;			/* saved buffer accesses */
+	u_int32			recovers;		/* power failure recoveries */
+	u_int32			bytesIn;		/* bytes written to buffer */
+	u_int32			bytesOut;		/* bytes taken from buffer */
+} STATS_CNT;
+
+/* sequencer segment */
+typedef struct {
+	u_int16			*data;			/* frames (4 values each) */
+	u_int32			alloc;			/* allocated memory [bytes] */
+	u_int32			frames;			/* number of frames */
+	u_int32			repeat;			/* passes before next (0=endless) */
+	int32			next;			/* next segment (-1=stop) */
+	int32			branch;			/* branch segment (-1=none) */
+} SEQ_SEG;
+
+/* driver ring indices (each in its own cache line) */
+typedef struct {
+	u_int8			pad0[RING_CL];
+	volatile u_int32 head;			/* bytes written (M37_BlockWrite) */
+	u_int8			pad1[RING_CL];
+	volatile u_int32 tail;			/* bytes read (ISR) */
+	u_int8			pad2[RING_CL];
+} RING_IDX;
+
 /* low-level handle */
 typedef struct {
 	/* general */
@@ -123,19 +318,159 @@ typedef struct {
 	/* misc */
     u_int32         irqCount;       /* interrupt counter */
     u_int32         idCheck;		/* id check enabled */
+	u_int16			idData[MOD_ID_SIZE/2];/* cached ID PROM image */
+	u_int16			idCsum;			/* checksum of idData */
+	u_int32			idValid;		/* idData read */
 	u_int32			extTrig;		/* external trigger */
 	u_int32			irqEn;			/* interrupt flag enable */
 	u_int32			irqOn;			/* irq on HW enable */
+	u_int32			mkIrq;			/* M_MK_IRQ_ENABLE enabled */
 	/* buffers */
 	MBUF_HANDLE		*bufHdl;		/* input buffer handle */
 	/* channels */
 	u_int16			chanVal[CH_NUMBER];/* storage for channels 0..3 */
+	u_int16			outVal[CH_NUMBER];/* last committed values */
+	u_int32			histSeq;		/* commit count */
+	HIST_REC		hist[HIST_DEPTH];/* output history */
+	/* commit timestamps */
+	u_int32			tsDiv;			/* timestamp every Nth commit (0=off) */
+	u_int32			tsCnt;			/* commits since last timestamp */
+	u_int32			tsIn;			/* timestamp ring write count */
+	u_int32			tsOut;			/* timestamp ring read count */
+	u_int32			tsLost;			/* overwritten timestamps */
+	TS_REC			ts[TS_DEPTH];	/* timestamp ring */
+	/* channel owners */
+	u_int16			own[CH_NUMBER];	/* channels owned by owner (curr. ch) */
+	u_int32			ownAll;			/* owned channels */
+	u_int16			slotVal[CH_NUMBER];/* latest values of owned channels */
+	/* setpoint schedule */
+	OSS_ALARM_HANDLE *alarmHdl;		/* schedule timer */
+	u_int32			alarmOn;		/* schedule timer running */
+	u_int32			schedClk;		/* schedule clock (M37_SCHED_CLK_xxx) */
+	u_int32			schedTrig;		/* trigger clock */
+	u_int32			schedIn;		/* queue write count */
+	u_int32			schedOut;		/* queue read count */
+	SCHED_ENTRY		sched[SCHED_DEPTH];/* schedule queue */
+	u_int32			lateIn;			/* lateness ring write count */
+	u_int32			lateOut;		/* lateness ring read count */
+	SCHED_LATE		late[SCHED_DEPTH];/* lateness ring */
+	u_int32			lateMax;		/* max. lateness */
+	/* ramps */
+	u_int32			rampMask;		/* channels with active ramp */
+	RAMP			ramp[CH_NUMBER];/* ramp state of channels 0..3 */
+	u_int32			slew[CH_NUMBER];/* slew limit of channels 0..3 (0=off) */
+	/* upsampling */
+	u_int32			upFactor;		/* upsampling factor (1=off) */
+	u_int32			upMode;			/* interpolation (M37_UPS_xxx) */
+	u_int32			upPhase;		/* output frame within input frame */
+	u_int32			upTail;			/* frames to output after last input */
+	u_int32			upIdle;			/* no stream data since last start */
+	int32			upHist[4][CH_NUMBER];/* last input frames (oldest first) */
+	int32			upCoef[UPS_MAX][4];/* FIR coefficients per phase */
+	/* stream format */
+	u_int32			fmt;			/* data format (M37_FMT_xxx) */
+	u_int8			unitBuf[CH_BYTES*CH_NUMBER];/* current buffer unit */
+	u_int32			unitPos;		/* read position in unitBuf */
+	u_int32			unitLen;		/* valid bytes in unitBuf */
+	u_int8			decBuf[1+CH_BYTES*CH_NUMBER];/* frame being decoded */
+	u_int32			decLen;			/* bytes in decBuf */
+	u_int16			decVal[CH_NUMBER];/* last decoded frame */
+	u_int32			decim[CH_NUMBER];/* decimation factors (M37_FMT_DECIM) */
+	u_int32			decCnt[CH_NUMBER];/* frames until channel is due */
+	u_int32			decDue;			/* channels due in next frame */
+	u_int32			decNeed;		/* bytes of next frame */
+	/* driver ring */
+	OSS_SEM_HANDLE	*devSemHdl;		/* device semaphore */
+	OSS_SEM_HANDLE	*ringSem;		/* wakes writer waiting for space */
+	u_int32			ringOn;			/* driver ring used instead of MBUF */
+	u_int32			ringSize;		/* ring size [bytes] (power of 2) */
+	u_int32			ringAlloc;		/* allocated ring memory [bytes] */
+	u_int8			*ringBuf;		/* ring memory */
+	volatile u_int32 ringWait;		/* writer waits for space */
+	u_int32			ringLow;		/* lowwater level [bytes] */
+	volatile u_int32 ringLowSent;	/* lowwater signal sent */
+	OSS_SIG_HANDLE	*ringSig;		/* lowwater signal */
+	u_int32			bufTout;		/* write timeout [msec] */
+	u_int32			bufSigLow;		/* M_BUF_WR_SIGSET_LOW signal (0=none) */
+	/* adaptive lowwater */
+	u_int32			bufLow;			/* MBUF lowwater level [bytes] */
+	u_int32			lowMargin;		/* safety margin [bytes] (0=off) */
+	u_int32			lowMax;			/* max. level [bytes] (0=half buffer) */
+	u_int32			lowEvent;		/* lowwater reached, refill pending */
+	u_int32			lowTick;		/* tick of lowwater event */
+	u_int32			lowFill;		/* min. fill since event [bytes] */
+	u_int32			lowReact;		/* last reaction time [ticks] */
+	RING_IDX		ringIdx;		/* producer/consumer index */
+	/* batch service */
+	u_int32			batchRate;		/* irq rate to switch on (0=off) */
+	u_int32			batchOn;		/* batch service active */
+	u_int32			batchSwitches;	/* number of switches */
+	u_int32			batchSaved;		/* saved buffer accesses */
+	u_int32			irqRate;		/* measured irq rate [1/s] */
+	u_int32			rateTick;		/* start of rate window */
+	u_int32			rateCnt;		/* interrupts in rate window */
+	u_int32			rateWin;		/* rate window [ticks] */
+	u_int8			pfBuf[PF_UNITS][CH_BYTES*CH_NUMBER];/* prefetched units */
+	u_int32			pfPos;			/* next unit in pfBuf */
+	u_int32			pfLen;			/* units in pfBuf */
+	/* statistics */
+	u_int32			underruns;		/* interrupts with empty buffer */
+	u_int32			pwrFails;		/* power supply failures */
+	u_int32			bufIn;			/* bytes written to output buffer */
+	u_int32			bufOut;			/* bytes output (or discarded) */
+	u_int32			fillMax;		/* max. buffer fill [bytes] */
+	u_int32			waitMax;		/* max. write time [ticks] */
+	STATS_CNT		stBase;			/* counters at last reset */
+	/* stream position */
+	u_int32			posFrames;		/* stream frames output */
+	u_int32			posSeq;			/* commit number of last stream frame */
+	/* status snapshot */
+	volatile u_int16 statSnap;		/* last read status register */
+	volatile u_int32 statTick;		/* tick of last status read */
+	u_int32			statMaxAge;		/* max. age of snapshot [msec] */
+	u_int32			statMaxTicks;	/* max. age of snapshot [ticks] */
+	volatile u_int32 pwrFail;		/* power supply failure latched */
+	OSS_SIG_HANDLE	*pwrSig;		/* power supply signal */
+	volatile u_int32 pwrLost;		/* power failure not yet recovered */
+	u_int32			pwrFailTick;	/* tick of power failure */
+	u_int32			pwrRcvMode;		/* recovery mode (M37_PWR_RCV_xxx) */
+	u_int32			pwrRcvs;		/* recoveries */
+	u_int32			pwrRcvTime;		/* downtime of last recovery [ticks] */
+	u_int32			pwrRcvMax;		/* max. downtime [ticks] */
+	u_int32			pwrWatch;		/* recovery by schedule timer */
+	u_int32			pwrStep;		/* timer recovery: halves written */
+	u_int32			pwrSafe;		/* trigger/irq disabled for recovery */
+	u_int16			pwrRestore;		/* conf. bits to restore (IRQE|EE) */
+	/* register access */
+	u_int32			d32;			/* D32 access (D32_xxx) */
+	u_int16			conf;			/* configuration register shadow */
+	u_int16			hwVal[2][CH_NUMBER];/* data registers of buffer halves */
+	u_int32			hwHalf;			/* buffer half written next */
+	u_int32			hwFull;			/* next commits write all channels */
+	volatile u_int32 busPath;		/* current access path (M37_BUS_xxx) */
+	u_int32			busRd[BUS_PATHS];/* bus reads per path */
+	u_int32			busWr[BUS_PATHS];/* bus writes per path */
+	/* trace */
+	u_int32			trcMask;		/* traced events */
+	u_int32			trcSeq;			/* trace ring write count */
+	u_int32			trcOut;			/* trace ring read count */
+	TRACE_REC		trc[TRACE_DEPTH];/* trace ring */
+	/* sequencer */
+	SEQ_SEG			seq[SEQ_SEGS];	/* segments */
+	volatile int32	seqCur;			/* current segment (-1=stopped) */
+	volatile u_int32 seqPos;		/* frame in current segment */
+	volatile u_int32 seqPass;		/* passes of current segment */
+	volatile u_int32 seqBranch;		/* pending branch (M37_SEQ_BR_xxx) */
 } LL_HANDLE;
 
 /* include files which need LL_HANDLE */
 #include <MEN/ll_entry.h>   /* low-level driver jump table  */
 #include <MEN/m37_drv.h>   /* M37 driver header file */
 
+#if BUS_PATHS != M37_BUS_PATHS		/* handle defined before the header */
+#	error "BUS_PATHS doesn't match M37_BUS_PATHS"
+#endif
+
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 
 /*-----------------------------------------+
@@ -159,6 +494,54 @@ static int32 M37_Info(int32 infoType, ... );
 static char* Ident( void );
 static int32 Cleanup(LL_HANDLE *llHdl, int32 retCode);
 static void PldLoad (LL_HANDLE *llHdl);						
+static void IdRead(LL_HANDLE *llHdl);
+static void StatsGet(LL_HANDLE *llHdl, M37_STATS *st, u_int32 reset);
+static void FillUpdate(LL_HANDLE *llHdl, u_int32 bytes, u_int32 start);
+static void PosGet(LL_HANDLE *llHdl, M37_POSITION *pos);
+static void LowTrack(LL_HANDLE *llHdl);
+static void LowAdapt(LL_HANDLE *llHdl);
+static void CommitFrame(LL_HANDLE *llHdl);
+static u_int32 SchedApply(LL_HANDLE *llHdl, u_int32 now);
+static void RampStart(LL_HANDLE *llHdl, int32 ch, u_int16 target,
+					  u_int32 steps, u_int32 maxStep);
+static u_int32 RampAdvance(LL_HANDLE *llHdl);
+static int32 ClockBusy(LL_HANDLE *llHdl);
+static int32 StreamNext(LL_HANDLE *llHdl);
+static int32 StreamRead(LL_HANDLE *llHdl, u_int16 *frame);
+static void StreamFmtSet(LL_HANDLE *llHdl, u_int32 fmt);
+static void DecimStep(LL_HANDLE *llHdl, u_int32 restart);
+static int32 UnitGet(LL_HANDLE *llHdl, u_int8 *unit);
+static int32 RingSet(LL_HANDLE *llHdl, u_int32 ringOn);
+static u_int32 UnitFetch(LL_HANDLE *llHdl);
+static void PfDiscard(LL_HANDLE *llHdl);
+static void RingRelease(LL_HANDLE *llHdl, u_int32 tail);
+static void BatchCheck(LL_HANDLE *llHdl);
+static int32 RingWrite(LL_HANDLE *llHdl, u_int8 *buf, int32 size,
+					   int32 *nbrWrBytesP);
+static u_int16 StatRead(LL_HANDLE *llHdl);
+static u_int16 StatReadLocked(LL_HANDLE *llHdl);
+static int32 PwrRecover(LL_HANDLE *llHdl);
+static void PwrSafe(LL_HANDLE *llHdl);
+static void PwrResume(LL_HANDLE *llHdl, u_int32 ok);
+static void PwrWatch(LL_HANDLE *llHdl);
+static void StatMaxAgeSet(LL_HANDLE *llHdl, u_int32 msec);
+static void TracePut(LL_HANDLE *llHdl, u_int32 type, u_int32 arg0,
+					 u_int32 arg1);
+static void TracePutLocked(LL_HANDLE *llHdl, u_int32 type, u_int32 arg0,
+						   u_int32 arg1);
+static void ConfWrite(LL_HANDLE *llHdl, u_int16 set, u_int16 clr);
+static void ConfWriteLocked(LL_HANDLE *llHdl, u_int16 set, u_int16 clr);
+static int32 ConfigSet(LL_HANDLE *llHdl, M37_CONFIG *cfgP);
+static int32 SeqRead(LL_HANDLE *llHdl, u_int16 *frame);
+static void SeqEnter(LL_HANDLE *llHdl, int32 seg);
+static int32 SeqLoad(LL_HANDLE *llHdl, M37_SEQ_SEG *segP, int32 size);
+static int32 OwnSet(LL_HANDLE *llHdl, int32 ch, u_int32 mask);
+static int32 OwnWrite(LL_HANDLE *llHdl, int32 ch, u_int16 *bufP, int32 size,
+					  int32 *nbrWrBytesP);
+static void OwnMerge(LL_HANDLE *llHdl);
+static void UpsampleSet(LL_HANDLE *llHdl, u_int32 factor, u_int32 mode);
+static void ClockStart(LL_HANDLE *llHdl);
+static void AlarmHandler(void *arg);
 
 /**************************** M37_GetEntry *********************************
  *
@@ -205,11 +588,18 @@ void M37_GetEntry( LL_ENTRY* drvP )
  *                OUT_BUF/MODE          0                0 | 2
  *                OUT_BUF/TIMEOUT       1000             0..max 
  *                OUT_BUF/LOWWATER      8                0..max
+ *                OUT_BUF/DRV_RING      0                0..1
+ *                OUT_BUF/LOW_MARGIN    0                0..max
+ *                ACCESS_D32            0                0..2
+ *                PWR_RECOVER           1                0..2
  *                
  *                PLD_LOAD defines if the PLD is loaded at INIT.
  *                With PLD_LOAD disabled, ID_CHECK is implicitly disabled.
  *                (This key is intended for test purposes and should always be
  *                set to 1.)
+ *                Before the PLD is loaded, the ID PROM image is read into a
+ *                cache, which serves M_LL_BLK_ID_DATA and M37_BLK_ID_INFO.
+ *                Without PLD_LOAD, it is read on the first request.
  *                
  *                EXT_TRIG defines if the transfer cycle is initiated by
  *                an internal or external trigger.
@@ -229,6 +619,37 @@ void M37_GetEntry( LL_ENTRY* drvP )
  *                OUT_BUF/LOWWATER defines the buffer level [bytes] of the
  *                corresponding lowwater buffer event (0 or multiple of 8).
  *                   (see MDIS User Guide)
+ *
+ *                OUT_BUF/DRV_RING selects the buffer of M_BUF_RINGBUF mode.
+ *                   0 = MBUF library
+ *                   1 = driver ring, OUT_BUF/SIZE rounded up to a power of 2,
+ *                       OUT_BUF/LOWWATER is the initial M37_RING_LOWWATER
+ *                   (see M37_DRV_RING)
+ *
+ *                OUT_BUF/LOW_MARGIN enables the adaptive lowwater level
+ *                with the given safety margin [bytes] (multiple of 8),
+ *                OUT_BUF/LOWWATER is the initial level (see M37_LOW_MARGIN).
+ *                   0 = static lowwater level
+ *
+ *                ACCESS_D32 enables D32 accesses to the data registers
+ *                (two channels per access). It requires a driver variant
+ *                built with M37_D32 (m37_d32 or the byte-swapped
+ *                m37_sw_d32), which requests the address space with
+ *                MDIS_MD32, and a carrier/bridge which supports D32 to
+ *                M-Module space. The data registers are write-only, so the
+ *                access can't be verified: the word order of the
+ *                carrier/bridge must be given (see M37_ACCESS_D32). A
+ *                byte-swapping bridge usually exchanges the words too.
+ *                   0 = D16 accesses
+ *                   1 = D32 accesses, even channel in upper word
+ *                   2 = D32 accesses, even channel in lower word
+ *
+ *                PWR_RECOVER defines what happens when the power supply
+ *                to the analog circuit returns after a failure
+ *                (see M37_PWR_RECOVER).
+ *                   0 = no re-init
+ *                   1 = re-init, restore the last values
+ *                   2 = re-init, set the outputs to 0V
  *                
  *---------------------------------------------------------------------------
  *  Input......:  descSpec   pointer to descriptor data
@@ -255,7 +676,8 @@ static int32 M37_Init(
     DBGCMD( static const char functionName[] = "LL - M37_Init()"; )
     LL_HANDLE *llHdl = NULL;
     u_int32 gotsize, pldLoad,
-			bufSize, bufMode, bufTout, bufLow, bufDbgLevel;
+			bufSize, bufMode, bufTout, bufLow, bufDbgLevel, drvRing,
+			accD32;
     u_int32 value,
 			ch,						
 			timeout;				
@@ -355,6 +777,28 @@ static int32 M37_Init(
 	if (llHdl->extTrig > 1)
 		return( Cleanup(llHdl,ERR_LL_ILL_PARAM));
 
+	/* ACCESS_D32 */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, FALSE,
+								&accD32, "ACCESS_D32")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+#ifdef M37_D32
+	if (accD32 > D32_LO)
+#else
+	if (accD32 != D32_OFF)					/* D16 variant */
+#endif
+		return( Cleanup(llHdl,ERR_LL_ILL_PARAM));
+
+	/* PWR_RECOVER */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, M37_PWR_RCV_LAST,
+								&llHdl->pwrRcvMode, "PWR_RECOVER")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	if (llHdl->pwrRcvMode > M37_PWR_RCV_SAFE)
+		return( Cleanup(llHdl,ERR_LL_ILL_PARAM));
+
 	/* OUT_BUF/SIZE */
 	if ( (error = DESC_GetUInt32(llHdl->descHdl, 160,
 								&bufSize, "OUT_BUF/SIZE")) &&
@@ -385,6 +829,32 @@ static int32 M37_Init(
 	if(bufLow%(CH_BYTES * CH_NUMBER))
 			return (Cleanup(llHdl, ERR_LL_ILL_PARAM)) ;
 
+	/* OUT_BUF/DRV_RING */
+	if ( (error = DESC_GetUInt32(llHdl->descHdl, FALSE,
+								&drvRing, "OUT_BUF/DRV_RING")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return(Cleanup(llHdl, error) );
+	if (drvRing > 1)
+		return (Cleanup(llHdl, ERR_LL_ILL_PARAM)) ;
+
+	/* OUT_BUF/LOW_MARGIN */
+	if ( (error = DESC_GetUInt32(llHdl->descHdl, 0,
+								&llHdl->lowMargin, "OUT_BUF/LOW_MARGIN")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return(Cleanup(llHdl, error) );
+	if ( (llHdl->lowMargin % (CH_BYTES * CH_NUMBER)) ||
+		 (llHdl->lowMargin >= bufSize) )
+		return (Cleanup(llHdl, ERR_LL_ILL_PARAM)) ;
+
+	llHdl->bufTout   = bufTout;
+	llHdl->bufLow    = bufLow;
+	llHdl->ringLow   = bufLow;
+	llHdl->devSemHdl = devSemHdl;
+	for (llHdl->ringSize = CH_BYTES * CH_NUMBER;	/* power of 2 >= bufSize */
+		 llHdl->ringSize < bufSize;
+		 llHdl->ringSize <<= 1)
+		;
+
     /*------------------------------+
     |  install buffer               |
     +------------------------------*/
@@ -397,11 +867,36 @@ static int32 M37_Init(
     MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_DEBUG_LEVEL, bufDbgLevel);
 
     /*------------------------------+
-    |  check M-Module ID            |
+    |  install schedule timer       |
+    +------------------------------*/
+	if ((error = OSS_AlarmCreate(llHdl->osHdl, AlarmHandler, llHdl,
+								 &llHdl->alarmHdl)))
+        return( Cleanup(llHdl,error) );
+
+	llHdl->schedClk = M37_SCHED_CLK_TIMER;
+	UpsampleSet(llHdl, 1, M37_UPS_HOLD);
+	for (ch=0; ch<CH_NUMBER; ch++)
+		llHdl->decim[ch] = 1;
+	StreamFmtSet(llHdl, M37_FMT_RAW);
+
+    /*------------------------------+
+    |  install driver ring          |
+    +------------------------------*/
+	if ((error = OSS_SemCreate(llHdl->osHdl, OSS_SEM_BIN, 0, &llHdl->ringSem)))
+        return( Cleanup(llHdl,error) );
+
+	if ((error = RingSet(llHdl, drvRing)))
+        return( Cleanup(llHdl,error) );
+
+    /*------------------------------+
+    |  read and check M-Module ID   |
     +------------------------------*/
+	if (pldLoad)
+		IdRead(llHdl);
+
 	if (llHdl->idCheck) {
-		int modIdMagic = m_read((U_INT32_OR_64)llHdl->ma, 0);
-		int modId      = m_read((U_INT32_OR_64)llHdl->ma, 1);
+		int modIdMagic = llHdl->idData[0];
+		int modId      = llHdl->idData[1];
 
 		if (modIdMagic != MOD_ID_MAGIC) {
 			DBGWRT_ERR((DBH," *** %s: illegal magic=0x%04x\n",
@@ -436,23 +931,34 @@ static int32 M37_Init(
     /*------------------------------+
     |  init hardware                |
     +------------------------------*/
-	MWRITE_D16 (llHdl->ma, CONF_REG, OE);	/* output enable, */
-											/*  disable IRQE & EE */
+	llHdl->conf = OE;						/* output enable, */
+	REG_WR16(llHdl, CONF_REG, llHdl->conf);	/*  disable IRQE & EE */
 	/* clear irq flag */
 	llHdl->irqEn = FALSE;
 	llHdl->irqOn = FALSE;
+	llHdl->seqCur = M37_SEQ_NONE;
+
+	llHdl->batchRate = BATCH_RATE;
+	if ((llHdl->rateWin = OSS_TickRateGet(osHdl) / 10) == 0)	/* 100ms */
+		llHdl->rateWin = 1;
+
+	StatMaxAgeSet(llHdl, STAT_MAXAGE);
+
+	/* D32 access as configured (data registers can't be read back) */
+	llHdl->d32 = accD32;
+	DBGWRT_2((DBH, "%s: D32 access mode %d\n", functionName, accD32));
 
     DBGWRT_2((DBH, "%s: reset channels\n", functionName));
 	/* clear first part of hardware buffer */
 	for (ch=0; ch<CH_NUMBER; ch++) {
-		MWRITE_D16 (llHdl->ma, DATA_REG(ch), 0x0000); /* channels are set to zero */	
+		REG_WR16(llHdl, DATA_REG(ch), 0x0000); /* channels are set to zero */	
 		llHdl->chanVal[ch] = 0x0000;			/* set the channel store to zero */
 	}
-	MSETMASK_D16 ( llHdl->ma, CONF_REG, UD);	/* update */	
+	REG_WR16(llHdl, CONF_REG, llHdl->conf | UD);	/* update */	
 	timeout = 0;
 	do  {	/* wait for buffer ready or break if power supply fails or timeout occurs */
 		OSS_Delay(llHdl->osHdl,10);
-		helpreg = MREAD_D16(llHdl->ma,STAT_REG);
+		helpreg = StatReadLocked(llHdl);
 		if (!(helpreg & PWR))  {	/* check power supply to analog part */
 			error = ERR_LL_DEV_NOTRDY;
 			DBGWRT_ERR((DBH," *** %s: PWR fails\n", functionName));
@@ -467,13 +973,14 @@ static int32 M37_Init(
 
 	/* clear 2nd part of hardware buffer */
 	for (ch=0; ch<CH_NUMBER; ch++) {
-		MWRITE_D16 (llHdl->ma, DATA_REG(ch), 0x0000);  	/* channels are set to zero */
+		REG_WR16(llHdl, DATA_REG(ch), 0x0000);  	/* channels are set to zero */
 	}
-	MSETMASK_D16 ( llHdl->ma, CONF_REG, UD);	/* update */	
+	REG_WR16(llHdl, CONF_REG, llHdl->conf | UD);	/* update */	
+	/* both buffer halves are zero now (hwVal) */
 	timeout = 0;
 	do  {	/* wait for buffer ready or break if power supply fails or timeout occurs */
 		OSS_Delay(llHdl->osHdl,10);
-		helpreg = MREAD_D16(llHdl->ma,STAT_REG);
+		helpreg = StatReadLocked(llHdl);
 		if (!(helpreg & PWR))  {	/* check power supply to analog part */
 			error = ERR_LL_DEV_NOTRDY;
 			DBGWRT_ERR((DBH," *** %s: PWR fails\n", functionName));
@@ -489,8 +996,7 @@ static int32 M37_Init(
 	/* config the trigger mode (int/ext) */
 	if (llHdl->extTrig){
 	    DBGWRT_2((DBH, "%s: set extTrig\n", functionName));
-		helpreg = MREAD_D16(llHdl->ma, STAT_REG) & ~UD;
-		MWRITE_D16(llHdl->ma, CONF_REG, (helpreg | EE));
+		ConfWriteLocked(llHdl, EE, 0);
 	}
 
 	*llHdlP = llHdl;
@@ -528,17 +1034,22 @@ static int32 M37_Exit(
     /*------------------------------+
     |  de-init hardware             |
     +------------------------------*/
-	MCLRMASK_D16(llHdl->ma, CONF_REG, (IRQE | EE | UD) );/* disable interrupt and trigger */
+	if (llHdl->alarmOn) {								/* stop schedule timer */
+		OSS_AlarmClear(llHdl->osHdl, llHdl->alarmHdl);
+		llHdl->alarmOn = FALSE;
+	}
+	llHdl->busPath = M37_BUS_OTHER;
+	ConfWriteLocked(llHdl, 0, (IRQE | EE));				/* disable interrupt and trigger */
 	llHdl->irqEn = FALSE;
 	llHdl->extTrig = FALSE;
 
 	for (ch=0; ch<CH_NUMBER; ch++) {
-		MWRITE_D16 (llHdl->ma, DATA_REG(ch), 0x0000);	/* channels are set to zero */
+		REG_WR16(llHdl, DATA_REG(ch), 0x0000);	/* channels are set to zero */
 		llHdl->chanVal[ch] = 0x0000;					/* set the channel store to zero */
 	}
-	MSETMASK_D16 ( llHdl->ma, CONF_REG, UD);			/* update */	
+	REG_WR16(llHdl, CONF_REG, llHdl->conf | UD);	/* update */	
 	do  {   /* wait for buffer ready or break if power supply fails */
-		helpreg = MREAD_D16(llHdl->ma,STAT_REG);
+		helpreg = StatReadLocked(llHdl);
 		if (!(helpreg & PWR))  {	/* check power supply to analog part */
 			DBGWRT_ERR((DBH," *** %s: PWR fails\n", functionName));
 			error= ERR_LL_DEV_NOTRDY;
@@ -546,7 +1057,7 @@ static int32 M37_Exit(
 		}
 	} while (!(helpreg & BUFRDY));
 
-	MWRITE_D16(llHdl->ma, CONF_REG, 0x00);				/* disable all */
+	ConfWriteLocked(llHdl, 0, llHdl->conf);				/* disable all */
 
     /*------------------------------+
     |  cleanup memory               |
@@ -561,8 +1072,9 @@ static int32 M37_Exit(
  *
  *  Description:  Read a value from the device
  *
- *                The function is not supported and always returns an 
- *                ERR_LL_ILL_FUNC error.
+ *                The function returns the last committed value of the
+ *                current channel (the value on the DAC after the update).
+ *                The hardware is not accessed.
  *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl    low-level handle
@@ -579,8 +1091,9 @@ static int32 M37_Read(
 {
     DBGCMD( static const char functionName[] = "LL - M37_Read"; )
     DBGWRT_1((DBH, "%s: ch=%d\n", functionName,ch));
-	
-	return(ERR_LL_ILL_FUNC);
+
+	*valueP = (int32)llHdl->outVal[ch];
+	return(ERR_SUCCESS);
 }
 
 /****************************** M37_Write ************************************
@@ -595,7 +1108,17 @@ static int32 M37_Read(
  *                affect the others. The values are stored in llHdl.
  *
  *                When power supply to the analog circuit fails while waiting 
- *                for BUFRDY, an error is reported.
+ *                for BUFRDY, an error is reported. After a power supply
+ *                failure, the function fails immediately (ERR_LL_DEV_NOTRDY)
+ *                until the status register shows the supply again.
+ *
+ *                When a slew limit is set for the channel (M37_SLEW_LIMIT)
+ *                and the step to the new value exceeds it, the channel is
+ *                moved by the limit and ramped to the value with the limit
+ *                as max. step per clock tick (see M37_BLK_RAMP).
+ *
+ *                A channel owned by another path (M37_CH_OWN) can't be
+ *                written (ERR_LL_DEV_BUSY).
  *                
  *---------------------------------------------------------------------------
  *  Input......:  llHdl    low-level handle
@@ -611,10 +1134,13 @@ static int32 M37_Write(
 )
 {
     DBGCMD( static const char functionName[] = "LL - M37_Write"; )
-	u_int32	n;
+	OSS_IRQ_STATE irqState;
+	int32	diff, error;
 	u_int16 helpreg;
 
     DBGWRT_1((DBH, "%s: ch=%d val=0x%04x\n", functionName,ch, value));
+	TRACE_LOCKED(llHdl, M37_TRC_WRITE, ch, value);
+	llHdl->busPath = M37_BUS_WRITE;
 
 	/* check if ext. trig. */
 	if (llHdl->extTrig)
@@ -623,14 +1149,40 @@ static int32 M37_Write(
 		return (ERR_LL_ILL_PARAM);
 	}
 
-	/* write value */
-	llHdl->chanVal[ch] = (u_int16)value;	/* update value for current channel storage */
-	for (n=0; n<CH_NUMBER; n++) {
-		MWRITE_D16 (llHdl->ma, DATA_REG(n),llHdl->chanVal[n]);	
+	/* check if owned by another path */
+	if ((llHdl->ownAll & ~llHdl->own[ch]) & (1<<ch))
+	{
+		DBGWRT_ERR((DBH," *** %s: ch %d owned\n", functionName, ch));
+		return (ERR_LL_DEV_BUSY);
+	}
+
+	/* fail fast after power supply failure (one recheck), recover */
+	if (llHdl->pwrLost && (error = PwrRecover(llHdl)))
+		return(error);
+
+	/* write value (locked against schedule timer) */
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	llHdl->rampMask &= ~(1<<ch);			/* write overrides ramp */
+	diff = (int16)value - (int16)llHdl->chanVal[ch];
+	if (llHdl->slew[ch] &&
+		(u_int32)(diff < 0 ? -diff : diff) > llHdl->slew[ch])  {
+		/* ramp with slew limit, first step now */
+		RampStart(llHdl, ch, (u_int16)value, 0, llHdl->slew[ch]);
+		RampAdvance(llHdl);
 	}
-	MSETMASK_D16 ( llHdl->ma, CONF_REG, UD);			/*update*/	
+	else
+		llHdl->chanVal[ch] = (u_int16)value;	/* update value for current channel storage */
+	if (llHdl->ownAll & (1<<ch))
+		llHdl->slotVal[ch] = (u_int16)value;	/* owned: keep latest value */
+	CommitFrame(llHdl);
+	llHdl->hwFull = 2;			/* buffer half not verified (BUFRDY) */
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	if (llHdl->rampMask)
+		ClockStart(llHdl);
+
 	do  {	/* wait for buffer ready or break if power supply fails */
-		helpreg = MREAD_D16(llHdl->ma,STAT_REG);
+		helpreg = StatReadLocked(llHdl);
 		if (!(helpreg & PWR))  {	/* check power supply to analog part */
 			DBGWRT_ERR((DBH," *** %s: PWR fails\n", functionName));
 			return(ERR_LL_DEV_NOTRDY);
@@ -657,6 +1209,54 @@ static int32 M37_Write(
  *                                                                M_BUF_RINGBUF
  *                -------------------  -------------------------  ----------
  *                M37_EXT_TRIG         defines the trigger mode	  0..1
+ *                M37_SCHED_CLK        clock of setpoint schedule 0..1
+ *                M37_SCHED_CLR        discard queued setpoints   -
+ *                M37_SCHED_LATE_MAX   reset max. lateness        -
+ *                M37_BLK_SCHED        queue setpoints            -
+ *                M37_SLEW_LIMIT       slew limit of current ch.  0..0xffff
+ *                M37_RAMP_STOP        stop ramp of current ch.   -
+ *                M37_BLK_RAMP         start ramp of current ch.  -
+ *                M37_UPSAMPLE         upsampling factor          1..32
+ *                M37_UPSAMPLE_MODE    upsampling interpolation   0..2
+ *                M37_STREAM_FMT       buffered output format     0..2
+ *                M37_DECIM            decimation factor of       1..0xffff
+ *                                     current ch.
+ *                M37_DRV_RING         driver ring instead of     0..1
+ *                                     MBUF
+ *                M37_RING_LOWWATER    lowwater level of driver   0..size-8
+ *                                     ring [bytes]
+ *                M37_RING_SIGSET_LOW  install ring lowwater      1..max
+ *                                     signal
+ *                M37_RING_SIGCLR_LOW  remove ring lowwater       -
+ *                                     signal
+ *                M37_LOW_MARGIN       adaptive lowwater margin   0..size-8
+ *                                     [bytes] (0 = off)
+ *                M37_LOW_MAX          max. adaptive lowwater     0..size-8
+ *                                     level [bytes]
+ *                                     (0 = half buffer)
+ *                M37_STAT_MAXAGE      max. age of status         0..max
+ *                                     snapshot [msec]
+ *                M37_PWR_SIGSET       install power supply       1..max
+ *                                     signal
+ *                M37_PWR_SIGCLR       remove power supply signal -
+ *                M37_PWR_RECOVER      power failure recovery     0..2
+ *                                      0 = no re-init
+ *                                      1 = restore last values
+ *                                      2 = outputs 0V
+ *                M37_TRACE_MASK       traced events (bit mask)   0..0x7f
+ *                M37_BUS_STAT_CLR     clear bus access counters  -
+ *                M37_ID_RELOAD        read ID PROM into cache    -
+ *                M37_TS_DIV           timestamp every Nth commit 0..max
+ *                                     (0 = off)
+ *                M37_BLK_CONFIG       stream configuration       -
+ *                M37_BLK_SEQ_SEG      load sequencer segment     -
+ *                M37_SEQ_START        start sequencer at segment -1..15
+ *                                      -1 = stop
+ *                M37_SEQ_BRANCH       request sequencer branch   0..2
+ *                M37_CH_OWN           channels owned by path     0..0xf
+ *                                     (bit mask, 0 = release)
+ *                M37_BATCH_RATE       irq rate for batch service 0..max
+ *                                     [1/s] (0 = off)
  *
  *
  *                M_MK_IRQ_ENABLE enables/disables the interrupt.
@@ -670,7 +1270,7 @@ static int32 M37_Write(
  *                on hardware is disabled in the ISR when all values have been
  *                written to the M37 M-Module. The flag remains enabled.
  *                Disabling the flag in SetStat also disables the interrupt
- *                on the hardware.
+ *                on the hardware and stops the sequencer.
  *
  *                The interrupt can only be enabled when the trigger is in external
  *                mode and M_BUF_WR_MODE is in M_BUF_RINGBUF mode.
@@ -688,7 +1288,199 @@ static int32 M37_Write(
  *                    1 = external trigger
  *                The trigger mode can only be disabled when the interrupt is
  *                disabled.
- * 
+ *
+ *
+ *                M37_SCHED_CLK defines the clock of the setpoint schedule.
+ *                It can only be changed while no setpoint is queued and no
+ *                ramp is active.
+ *                    0 = M37_SCHED_CLK_TIMER: system ticks. Due setpoints
+ *                        are applied by a driver timer (1 msec period).
+ *                    1 = M37_SCHED_CLK_TRIG: conversion triggers. Due
+ *                        setpoints are applied in the ISR. The clock counts
+ *                        the interrupts serviced while the interrupt is
+ *                        enabled on the hardware (during buffered output or
+ *                        while setpoints are queued). Requires the
+ *                        external trigger (M37_EXT_TRIG) and an enabled
+ *                        interrupt flag (M_MK_IRQ_ENABLE), otherwise
+ *                        ERR_LL_ILL_PARAM is returned.
+ *
+ *                M37_BLK_SCHED queues up to 64 setpoints (M37_SCHED_ENTRY).
+ *                The entries must be ordered by their due time. Each entry
+ *                updates the channels in chMask. All entries due at the
+ *                same clock tick are committed with one update strobe.
+ *                The lateness of each applied entry is recorded and can
+ *                be read with M37_BLK_SCHED_LATE. If the queue has no
+ *                room for all entries, none is queued and ERR_LL_DEV_BUSY
+ *                is returned.
+ *
+ *                M37_SLEW_LIMIT sets the max. step of the current channel
+ *                per write or clock tick (0 = no limit). It is enforced by
+ *                M37_Write and limits the steps of ramps.
+ *
+ *                M37_BLK_CONFIG sets several stream parameters
+ *                (M37_CONFIG) in one call. The fields selected by 'valid'
+ *                replace the current settings. The resulting configuration
+ *                is validated as a whole (e.g. the interrupt flag requires
+ *                external trigger and M_BUF_RINGBUF), so the order of the
+ *                single status codes doesn't matter. If it is invalid,
+ *                nothing is changed. Otherwise a running stream is paused,
+ *                the parameters are applied and the configuration register
+ *                is written once.
+ *                The interrupt flag (irqEn) is the driver flag only: the
+ *                MDIS kernel interrupt must have been enabled before with
+ *                M_MK_IRQ_ENABLE.
+ *                sigLow installs (or with 0 removes) the signal of
+ *                M_BUF_WR_SIGSET_LOW. When the new signal can't be
+ *                installed, the previous one is installed again.
+ *
+ *                M37_BLK_RAMP moves the current channel from its value to
+ *                the target value (M37_RAMP) in steps of the schedule clock
+ *                (M37_SCHED_CLK): either within 'steps' clock ticks or with
+ *                at most 'maxStep' per tick (steps = 0). The values are
+ *                treated as signed codes. While the ramp is active it
+ *                overrides queued setpoints and buffered output for the
+ *                channel. M37_Write or M37_RAMP_STOP end the ramp.
+ *
+ *                M37_UPSAMPLE defines the number of output frames per
+ *                frame of the output buffer (M_BUF_RINGBUF). The ISR
+ *                computes the intermediate frames as defined by
+ *                M37_UPSAMPLE_MODE:
+ *                    0 = M37_UPS_HOLD: zero-order hold
+ *                    1 = M37_UPS_LINEAR: linear interpolation
+ *                        (delay of 1 buffer frame)
+ *                    2 = M37_UPS_FIR: 4-tap cubic (Catmull-Rom) FIR in
+ *                        fixed point (delay of 2 buffer frames)
+ *                The values are treated as signed codes. Setting one of
+ *                the codes restarts the interpolation at the current
+ *                output values.
+ *
+ *                M37_STREAM_FMT defines the format of the data written to
+ *                the output buffer (M_BUF_RINGBUF), see M37_BlockWrite:
+ *                    0 = M37_FMT_RAW: 4 words per frame
+ *                    1 = M37_FMT_DELTA: delta encoded byte stream
+ *                    2 = M37_FMT_DECIM: values of the channels due
+ *                        (M37_DECIM)
+ *                Setting the code discards a partially decoded frame.
+ *                Deltas are applied to the last decoded frame, initially
+ *                the current output values.
+ *
+ *                M37_DECIM defines the decimation factor N of the current
+ *                channel for M37_FMT_DECIM (default 1). The channel takes a
+ *                new value on every Nth frame and holds it in between. At
+ *                least one channel must keep factor 1 (ERR_LL_ILL_PARAM),
+ *                it defines the frame rate. Setting the code restarts the
+ *                pattern: all channels are due in the next frame. A
+ *                partially decoded frame is discarded.
+ *
+ *                M37_DRV_RING selects the buffer of M_BUF_RINGBUF mode:
+ *                    0 = MBUF library
+ *                    1 = driver ring: a single-producer/single-consumer
+ *                        ring between M37_BlockWrite and the ISR without
+ *                        locks. M_BUF_WR_TIMEOUT applies, the other MBUF
+ *                        codes refer to the (unused) MBUF buffer.
+ *                The buffer can only be changed while the interrupt flag
+ *                is disabled. Data queued in the driver ring is discarded.
+ *
+ *                M37_RING_SIGSET_LOW installs a signal which is sent by the
+ *                ISR when the driver ring fill level drops to
+ *                M37_RING_LOWWATER (multiple of 8). The signal is sent once,
+ *                and again after M37_BlockWrite has filled the ring above
+ *                the level. This allows to keep the ring filled with large
+ *                blocks instead of polling.
+ *
+ *                M37_LOW_MARGIN enables the adaptive lowwater level of the
+ *                output buffer (M_BUF_WR_LOWWATER or M37_RING_LOWWATER,
+ *                whichever is used) with a safety margin [bytes]. The ISR
+ *                notes when the fill level drops to the lowwater level and
+ *                the lowest fill level until the next M37_BlockWrite. Then
+ *                the level is adjusted: raised by the shortfall when the
+ *                fill dropped below the margin (doubled after an
+ *                underrun), lowered by 1/8 of the excess otherwise, so
+ *                that the application is woken as late, and as rarely, as
+ *                its reaction time allows. The level stays between 8 and
+ *                M37_LOW_MAX. Setting a lowwater level directly restarts
+ *                the adaptation from it. The current level is returned by
+ *                M37_LOW_LEVEL, the time from the last lowwater event to
+ *                the refill by M37_LOW_REACT.
+ *
+ *                M37_STAT_MAXAGE defines how long the status register
+ *                snapshot is used by M37_PWR_SUPPL before the register is
+ *                read again (default 10ms). The snapshot is updated by the
+ *                status reads of the write functions and the ISR.
+ *
+ *                M37_PWR_SIGSET installs a signal which is sent when the
+ *                power supply to the analog circuit fails or is restored.
+ *                M37_PWR_SUPPL returns the new state.
+ *
+ *                M37_PWR_RECOVER defines how the driver recovers from a
+ *                power supply failure (default: descriptor PWR_RECOVER).
+ *                The write functions fail with ERR_LL_DEV_NOTRDY while the
+ *                supply is missing. The first write after it has returned
+ *                re-initializes the module in place: both buffer halves
+ *                are written with the last values (M37_PWR_RCV_LAST) or
+ *                0V (M37_PWR_RCV_SAFE, stops the ramps), then the
+ *                configuration register is restored, which resumes the
+ *                trigger mode and the buffered output. Queued output data
+ *                is kept. With the interrupt flag enabled, the schedule
+ *                timer also recovers when the supply returns, so that a
+ *                writer blocked in M37_BlockWrite resumes without another
+ *                write. M37_PWR_RCV_OFF only clears the failure.
+ *                The recoveries are counted (M37_PWR_RCV_COUNT) with the
+ *                time from the failure to the recovery (M37_PWR_RCV_TIME).
+ *
+ *                M37_TRACE_MASK selects the events recorded in the trace
+ *                ring (bit 1<<M37_TRC_xxx, 0 = off). Setting the mask
+ *                discards the recorded events. The ring holds the last 256
+ *                records, see M37_BLK_TRACE.
+ *
+ *                M37_BATCH_RATE defines the interrupt rate at which the ISR
+ *                switches to batch service (default 5000/s, 0 = never),
+ *                see M37_Irq. It switches back when the rate drops below
+ *                half of it. The rate is measured over 100ms.
+ *
+ *                M37_TS_DIV enables the commit timestamps: every Nth
+ *                committed frame (update strobe of ISR, write functions or
+ *                schedule timer) is timestamped. Setting the code
+ *                discards the recorded timestamps, the next commit is
+ *                timestamped. See M37_BLK_TSTAMP.
+ *
+ *                M37_ID_RELOAD reads the ID PROM into the cache again, e.g.
+ *                after the PROM has been programmed.
+ *
+ *                M37_BLK_SEQ_SEG loads one of 16 sequencer segments: an
+ *                M37_SEQ_SEG header followed by 'frames' x 4 channel values
+ *                (max. 65536 frames, 0 = delete). The segment is output
+ *                'repeat' times (0 = endless), then the sequence continues
+ *                with segment 'next' (M37_SEQ_NONE = stop). The current
+ *                segment can't be loaded (ERR_LL_DEV_BUSY), all others
+ *                can be replaced while the sequence runs.
+ *                M37_SEQ_START starts the sequence at the given segment
+ *                (-1 = stop). It requires the interrupt flag
+ *                (M_MK_IRQ_ENABLE). The ISR takes one frame per trigger
+ *                and steps to the following segment without a gap. While
+ *                the sequence runs it replaces the output buffer, the
+ *                buffered data is output when the sequence has stopped.
+ *                M37_SEQ_BRANCH requests the branch of the current segment:
+ *                    0 = M37_SEQ_BR_OFF: cancel request
+ *                    1 = M37_SEQ_BR_END: at the end of the segment pass
+ *                    2 = M37_SEQ_BR_NOW: at the next frame
+ *                The request is taken by the first segment with a branch
+ *                link and is cleared when a segment is entered.
+ *
+ *                M37_CH_OWN claims the channels of the mask for the calling
+ *                path, so that several paths can write different channels
+ *                independently. The driver doesn't know the path: the
+ *                owner is identified by the current channel of the path
+ *                (M_MK_CH_CURRENT), which must be within the mask. Channels
+ *                owned by another path can't be claimed (ERR_LL_DEV_BUSY).
+ *                Ownership is not released when the path is closed, it
+ *                must be released with mask 0.
+ *                Each owned channel has a latest-value slot. M37_BlockWrite
+ *                of an owner writes one word per owned channel (ascending)
+ *                to the slots without waiting, see M37_BlockWrite. The
+ *                slots replace the values of buffered output and of
+ *                M37_BlockWrite of non-owners for the owned channels.
+ *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl             low-level handle
  *                code              status code
@@ -708,14 +1500,16 @@ static int32 M37_SetStat(
 {
     int32 value = (int32)value32_or_64;	    /* 32bit value */
     /* INT32_OR_64 valueP = value32_or_64;     stores 32/64bit pointer */
+    M_SG_BLOCK *blk = (M_SG_BLOCK*)value32_or_64; /* stores block struct pointer */
     DBGCMD( static const char functionName[] = "LL - M37_SetStat"; )
 	int32 error = ERR_SUCCESS;
 	int32 bufMode;
-	u_int16	helpreg;
+	OSS_IRQ_STATE irqState;
 
 
     DBGWRT_1((DBH, "%s: ch=%d code=0x%04x value=0x%x\n",
 			  functionName,ch,code,value));
+	llHdl->busPath = M37_BUS_OTHER;
 
     switch(code) {
         /*--------------------------+
@@ -745,12 +1539,18 @@ static int32 M37_SetStat(
 					break;
 				}
 				llHdl->irqEn = TRUE;  /* set interrupt enable flag */
+				llHdl->mkIrq = TRUE;
 			}   
 			/* disable irq and interrupt flags*/
 			else {											
-				MCLRMASK_D16(llHdl->ma, CONF_REG, (IRQE | UD) );
+				irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+				ConfWrite(llHdl, 0, IRQE);
 				llHdl->irqEn = FALSE;
 				llHdl->irqOn = FALSE;		
+				llHdl->mkIrq = FALSE;
+				llHdl->seqCur = M37_SEQ_NONE;	/* stop sequencer */
+				PfDiscard(llHdl);				/* stream stopped */
+				OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
 			}
             break;
         /*--------------------------+
@@ -777,8 +1577,7 @@ static int32 M37_SetStat(
 			/* enable external */
 			if (value){						
 				llHdl->extTrig = TRUE;
-				helpreg = MREAD_D16(llHdl->ma, STAT_REG) & ~UD;
-				MWRITE_D16(llHdl->ma, CONF_REG, (helpreg | EE) );				
+				ConfWriteLocked(llHdl, EE, 0);
 			}
 			/* disable external trigger ... */
 			else {							
@@ -786,13 +1585,199 @@ static int32 M37_SetStat(
 					error = ERR_LL_ILL_PARAM;
 					break;
 				}
-				MCLRMASK_D16(llHdl->ma, CONF_REG, ( EE | UD) );
+				ConfWriteLocked(llHdl, 0, EE);
 				llHdl->extTrig = FALSE;
 			}
 			break;
+        /*--------------------------+
+        |  driver ring              |
+        +--------------------------*/
+        case M37_DRV_RING:
+			if ( (value < 0) || (value > 1) || llHdl->irqEn )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			error = RingSet(llHdl, value);
+			break;
+		case M37_RING_LOWWATER:
+			if ( (value < 0) || (value >= (INT32_OR_64)llHdl->ringSize) ||
+				 (value % (CH_BYTES * CH_NUMBER)) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			llHdl->ringLow  = value;
+			llHdl->lowEvent = FALSE;
+			break;
+        /*--------------------------+
+        |  adaptive lowwater        |
+        +--------------------------*/
+		case M37_LOW_MARGIN:
+		case M37_LOW_MAX:
+		{
+			int32 size;
+
+			if (llHdl->ringOn)
+				size = (int32)llHdl->ringSize;
+			else
+				MBUF_GetStat(NULL, llHdl->bufHdl, M_BUF_WR_BUFSIZE, &size);
+			if ( (value < 0) || (value >= size) ||
+				 (value % (CH_BYTES * CH_NUMBER)) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			if (code == M37_LOW_MAX)
+				llHdl->lowMax = value;
+			else
+				llHdl->lowMargin = value;
+			llHdl->lowEvent = FALSE;
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+		}
+		case M37_RING_SIGSET_LOW:
+			if (llHdl->ringSig) {				/* already defined ? */
+				error = ERR_OSS_SIG_SET;
+				break;
+			}
+			llHdl->ringLowSent = FALSE;
+			error = OSS_SigCreate(llHdl->osHdl, (int32)value, &llHdl->ringSig);
+			break;
+		case M37_RING_SIGCLR_LOW:
+			if (llHdl->ringSig == NULL) {		/* not defined ? */
+				error = ERR_OSS_SIG_CLR;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			error = OSS_SigRemove(llHdl->osHdl, &llHdl->ringSig);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+        /*--------------------------+
+        |  power supply             |
+        +--------------------------*/
+		case M37_STAT_MAXAGE:
+			if (value < 0) {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			StatMaxAgeSet(llHdl, value);
+			break;
+		case M37_PWR_SIGSET:
+			if (llHdl->pwrSig) {				/* already defined ? */
+				error = ERR_OSS_SIG_SET;
+				break;
+			}
+			error = OSS_SigCreate(llHdl->osHdl, (int32)value, &llHdl->pwrSig);
+			break;
+		case M37_PWR_SIGCLR:
+			if (llHdl->pwrSig == NULL) {		/* not defined ? */
+				error = ERR_OSS_SIG_CLR;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			error = OSS_SigRemove(llHdl->osHdl, &llHdl->pwrSig);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+		case M37_PWR_RECOVER:
+			if (value < M37_PWR_RCV_OFF || value > M37_PWR_RCV_SAFE) {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			llHdl->pwrRcvMode = value;
+			break;
+        /*--------------------------+
+        |  sequencer                |
+        +--------------------------*/
+		case M37_SEQ_START:
+			if (value == M37_SEQ_NONE) {
+				llHdl->seqCur = M37_SEQ_NONE;
+				break;
+			}
+			if ( (value < 0) || (value >= SEQ_SEGS) ||
+				 !llHdl->seq[value].frames || !llHdl->irqEn )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			SeqEnter(llHdl, value);
+			ConfWrite(llHdl, IRQE, 0);		/* enable interrupt on hardware */
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+		case M37_SEQ_BRANCH:
+			if ( (value < M37_SEQ_BR_OFF) || (value > M37_SEQ_BR_NOW) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			llHdl->seqBranch = value;
+			break;
+        /*--------------------------+
+        |  channel owners           |
+        +--------------------------*/
+		case M37_CH_OWN:
+			error = OwnSet(llHdl, ch, value);
+			break;
+        /*--------------------------+
+        |  batch service            |
+        +--------------------------*/
+		case M37_BATCH_RATE:
+			if (value < 0)  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			llHdl->batchRate = value;
+			break;
+        /*--------------------------+
+        |  bus access counters      |
+        +--------------------------*/
+		case M37_BUS_STAT_CLR:
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			OSS_MemFill(llHdl->osHdl, sizeof(llHdl->busRd),
+						(char*)llHdl->busRd, 0);
+			OSS_MemFill(llHdl->osHdl, sizeof(llHdl->busWr),
+						(char*)llHdl->busWr, 0);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+        /*--------------------------+
+        |  ID PROM cache            |
+        +--------------------------*/
+		case M37_ID_RELOAD:
+			IdRead(llHdl);
+			break;
+        /*--------------------------+
+        |  commit timestamps        |
+        +--------------------------*/
+		case M37_TS_DIV:
+			if (value < 0)  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			llHdl->tsIn   = 0;
+			llHdl->tsOut  = 0;
+			llHdl->tsLost = 0;
+			llHdl->tsCnt  = value ? value - 1 : 0;
+			llHdl->tsDiv  = value;
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+        /*--------------------------+
+        |  trace                    |
+        +--------------------------*/
+		case M37_TRACE_MASK:
+			if (value & ~((1<<M37_TRC_NUM) - 1)) {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			llHdl->trcOut  = llHdl->trcSeq;
+			llHdl->trcMask = value;
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
 		/*------------------------------------------+
         |  not supportet MBUF modes and MBUF values |
 		+------------------------------------------*/
+		case M_BUF_WR_TIMEOUT:
+			if ( (error = MBUF_SetStat(NULL, llHdl->bufHdl, code, value)) == 0 )
+				llHdl->bufTout = value;
+			break;
         case M_BUF_WR_MODE:
 			if ( (llHdl->irqEn) && (value == M_BUF_USRCTRL) )  {
 				error = ERR_LL_ILL_PARAM;  /* M_BUF_USRCTRL only if interrupt is disabled */
@@ -802,37 +1787,256 @@ static int32 M37_SetStat(
 				error = ERR_LL_ILL_PARAM;
 				break;
 			}
-			error = MBUF_SetStat(NULL, llHdl->bufHdl, code, value);
+			if  (( error = MBUF_GetBufferMode(llHdl->bufHdl, &bufMode)))
+				break;
+			if ((error = MBUF_SetStat(NULL, llHdl->bufHdl, code, value)) == 0 &&
+				value != bufMode) {
+				irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+				PfDiscard(llHdl);				/* units of the old mode */
+				OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			}
 			break;
 		case M_BUF_WR_LOWWATER:
 			if(value%(CH_BYTES * CH_NUMBER))  {
 				error =  ERR_LL_ILL_PARAM;
 				break;
 			}
-			error = MBUF_SetStat(NULL, llHdl->bufHdl, code, value);
+			if ((error = MBUF_SetStat(NULL, llHdl->bufHdl, code, value)) == 0) {
+				llHdl->bufLow   = value;
+				llHdl->lowEvent = FALSE;
+			}
 			break;
         /*--------------------------+
-        |  MBUF + (unknown)         |
+        |  schedule clock           |
         +--------------------------*/
-        default:
-			if ( M_BUF_CODE(code) )  {
-				error = MBUF_SetStat(NULL, llHdl->bufHdl, code, value);
+		case M37_SCHED_CLK:
+			if ( (value < M37_SCHED_CLK_TIMER) || (value > M37_SCHED_CLK_TRIG) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
 			}
-			else
-                error = ERR_LL_UNK_CODE;
-    }
+			/* trigger clock needs external trigger and interrupt */
+			if ( (value == M37_SCHED_CLK_TRIG) &&
+				 (!llHdl->extTrig || !llHdl->irqEn) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			if (ClockBusy(llHdl))  {		/* setpoints queued or ramps active */
+				error = ERR_LL_DEV_BUSY;
+				break;
+			}
+			llHdl->schedClk = value;
+			break;
+        /*--------------------------+
+        |  discard schedule         |
+        +--------------------------*/
+		case M37_SCHED_CLR:
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			llHdl->schedOut = llHdl->schedIn;
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+        /*--------------------------+
+        |  reset max. lateness      |
+        +--------------------------*/
+		case M37_SCHED_LATE_MAX:
+			llHdl->lateMax = 0;
+			break;
+        /*--------------------------+
+        |  queue setpoints          |
+        +--------------------------*/
+		case M37_BLK_SCHED:
+		{
+			M37_SCHED_ENTRY *entP = (M37_SCHED_ENTRY*)blk->data;
+			SCHED_ENTRY		*schedP;
+			u_int32			n, nbr, last;
 
-	return(error);
-}
+			nbr = blk->size / sizeof(M37_SCHED_ENTRY);
+			if ( !nbr || (blk->size % sizeof(M37_SCHED_ENTRY)) )  {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			/* trigger clock runs only with external trigger and interrupt */
+			if ( (llHdl->schedClk == M37_SCHED_CLK_TRIG) &&
+				 (!llHdl->extTrig || !llHdl->irqEn) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			for (n=0; n<nbr; n++)  {
+				if ( entP[n].chMask & ~((1<<CH_NUMBER)-1) )  {
+					error = ERR_LL_ILL_PARAM;
+					break;
+				}
+			}
+			if (error)
+				break;
 
-/****************************** M37_GetStat **********************************
- *
- *  Description:  Get the driver status
- *
- *                The following status codes are supported:
- *
- *                Code                 Description                Values
- *                -------------------  -------------------------  ----------
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			if ( nbr > SCHED_DEPTH - (llHdl->schedIn - llHdl->schedOut) )
+				error = ERR_LL_DEV_BUSY;
+
+			/* entries must be ordered by due time */
+			last = (llHdl->schedIn != llHdl->schedOut) ?
+				llHdl->sched[(llHdl->schedIn - 1) % SCHED_DEPTH].time :
+				entP[0].time;
+			for (n=0; !error && n<nbr; n++)  {
+				if ( (int32)(entP[n].time - last) < 0 )
+					error = ERR_LL_ILL_PARAM;
+				last = entP[n].time;
+			}
+
+			for (n=0; !error && n<nbr; n++)  {
+				schedP = &llHdl->sched[(llHdl->schedIn + n) % SCHED_DEPTH];
+				schedP->time   = entP[n].time;
+				schedP->mask   = (u_int16)entP[n].chMask;
+				schedP->val[0] = entP[n].val[0];
+				schedP->val[1] = entP[n].val[1];
+				schedP->val[2] = entP[n].val[2];
+				schedP->val[3] = entP[n].val[3];
+			}
+			if (!error)
+				llHdl->schedIn += nbr;
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			if (error)  {
+				DBGWRT_ERR((DBH," *** %s: can't queue %d setpoints\n",
+							functionName, nbr));
+				break;
+			}
+
+			ClockStart(llHdl);
+			break;
+		}
+        /*--------------------------+
+        |  upsampling               |
+        +--------------------------*/
+		case M37_UPSAMPLE:
+		case M37_UPSAMPLE_MODE:
+			if ( (code == M37_UPSAMPLE &&
+				  ((value < 1) || (value > M37_UPS_MAX))) ||
+				 (code == M37_UPSAMPLE_MODE &&
+				  ((value < M37_UPS_HOLD) || (value > M37_UPS_FIR))) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			UpsampleSet(llHdl,
+						code == M37_UPSAMPLE ? (u_int32)value : llHdl->upFactor,
+						code == M37_UPSAMPLE_MODE ? (u_int32)value : llHdl->upMode);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+        /*--------------------------+
+        |  stream format            |
+        +--------------------------*/
+		case M37_STREAM_FMT:
+			if ( (value < M37_FMT_RAW) || (value > M37_FMT_DECIM) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			StreamFmtSet(llHdl, value);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+		case M37_DECIM:
+		{
+			u_int32			n;
+
+			if ( (value < 1) || (value > M37_DECIM_MAX) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			/* one channel must define the frame rate */
+			for (n=0; n<CH_NUMBER; n++)
+				if ( (n == (u_int32)ch ? (u_int32)value : llHdl->decim[n]) == 1 )
+					break;
+			if (n == CH_NUMBER)  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			llHdl->decim[ch] = value;
+			StreamFmtSet(llHdl, llHdl->fmt);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+		}
+        /*--------------------------+
+        |  slew limit               |
+        +--------------------------*/
+		case M37_SLEW_LIMIT:
+			if ( (value < 0) || (value > 0xffff) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			llHdl->slew[ch] = value;
+			break;
+        /*--------------------------+
+        |  ramp                     |
+        +--------------------------*/
+		case M37_RAMP_STOP:
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			llHdl->rampMask &= ~(1<<ch);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+		case M37_BLK_SEQ_SEG:
+			error = SeqLoad(llHdl, (M37_SEQ_SEG*)blk->data, blk->size);
+			break;
+		case M37_BLK_CONFIG:
+			if (blk->size < (int32)sizeof(M37_CONFIG))  {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			error = ConfigSet(llHdl, (M37_CONFIG*)blk->data);
+			break;
+		case M37_BLK_RAMP:
+		{
+			M37_RAMP *rampP = (M37_RAMP*)blk->data;
+
+			if (blk->size < (int32)sizeof(M37_RAMP))  {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			if ( (!rampP->steps && !rampP->maxStep) ||
+				 ((llHdl->schedClk == M37_SCHED_CLK_TRIG) &&
+				  (!llHdl->extTrig || !llHdl->irqEn)) )  {
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			RampStart(llHdl, ch, (u_int16)rampP->target, rampP->steps,
+					  rampP->maxStep);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			ClockStart(llHdl);
+			break;
+		}
+        /*--------------------------+
+        |  MBUF + (unknown)         |
+        +--------------------------*/
+        default:
+			if ( M_BUF_CODE(code) )  {
+				error = MBUF_SetStat(NULL, llHdl->bufHdl, code, value);
+				if (!error && code == M_BUF_WR_SIGSET_LOW)
+					llHdl->bufSigLow = value;	/* installed signal */
+				if (!error && code == M_BUF_WR_SIGCLR_LOW)
+					llHdl->bufSigLow = 0;
+			}
+			else
+                error = ERR_LL_UNK_CODE;
+    }
+
+	/* trace accepted settings only */
+	if (error == ERR_SUCCESS)
+		TRACE_LOCKED(llHdl, M37_TRC_CONFIG, code, value);
+
+	return(error);
+}
+
+/****************************** M37_GetStat **********************************
+ *
+ *  Description:  Get the driver status
+ *
+ *                The following status codes are supported:
+ *
+ *                Code                 Description                Values
+ *                -------------------  -------------------------  ----------
  *                M_LL_DEBUG_LEVEL     driver debug level         see dbg.h
  *                M_LL_CH_NUMBER       number of channels         4
  *                M_LL_CH_DIR          direction of curr. ch.     M_CH_OUT
@@ -841,7 +2045,7 @@ static int32 M37_SetStat(
  *                M_LL_IRQ_COUNT       interrupt counter          0..max
  *                M_LL_ID_CHECK        EEPROM is checked          0..1
  *                M_LL_ID_SIZE         EEPROM size [bytes]        128
- *                M_LL_BLK_ID_DATA     EEPROM raw data            -
+ *                M_LL_BLK_ID_DATA     EEPROM raw data (cached)   -
  *                M_MK_BLK_REV_ID      ident function table ptr   -
  *                -------------------  -------------------------  ----------
  *                M37_EXT_TRIG         defines the trigger mode	  0..1
@@ -851,6 +2055,143 @@ static int32 M37_SetStat(
  *                                     circuit
  *                                      0 = analog part is not supplied
  *                                      1 = analog part is supplied
+ *                M37_STAT_MAXAGE      max. age of status         0..max
+ *                                     snapshot [msec]
+ *                M37_PWR_RECOVER      power failure recovery     0..2
+ *                M37_PWR_RCV_COUNT    power failure recoveries   0..max
+ *                M37_PWR_RCV_TIME     downtime of last recovery  0..max
+ *                                     [msec]
+ *                M37_TRACE_MASK       traced events (bit mask)   0..0x7f
+ *                M37_TRACE_RATE       trace tick rate [1/s]      1..max
+ *                                     (system tick, typ. 100..1000)
+ *                M37_ACCESS_D32       D32 data register access   0..2
+ *                                     (see descriptor ACCESS_D32)
+ *                M37_BLK_BUS_STAT     bus access counters        -
+ *                M37_BLK_CONFIG       stream configuration       -
+ *                M37_BLK_TRACE        recorded trace events      -
+ *                M37_BLK_ID_INFO      module identification      -
+ *                M37_BLK_STATS        statistics snapshot        -
+ *                M37_BLK_TSTAMP       recorded commit timestamps -
+ *                M37_BLK_POSITION     stream output position     -
+ *                M37_TS_DIV           timestamp every Nth commit 0..max
+ *                M37_TS_RATE          timestamp rate [1/s]       1..max
+ *                M37_TS_LOST          overwritten timestamps     0..max
+ *                M37_BLK_STATS_CLR    statistics snapshot and    -
+ *                                     reset of counters
+ *                M37_ID_CSUM          checksum of cached ID PROM 0..0xffff
+ *                                     image
+ *                M37_SCHED_CLK        clock of setpoint schedule 0..1
+ *                M37_SCHED_TIME       current schedule time      0..max
+ *                M37_SCHED_RATE       schedule clock rate [1/s]  0..max
+ *                                      0 = trigger clock
+ *                M37_SCHED_COUNT      number of queued setpoints 0..64
+ *                M37_SCHED_LATE_MAX   max. lateness of applied   0..max
+ *                                     setpoints
+ *                M37_BLK_SCHED_LATE   lateness of applied        -
+ *                                     setpoints
+ *                M37_SLEW_LIMIT       slew limit of current ch.  0..0xffff
+ *                M37_RAMP_STATE       ramp of current channel    0..1
+ *                                      0 = idle
+ *                                      1 = active
+ *                M37_UPSAMPLE         upsampling factor          1..32
+ *                M37_UPSAMPLE_MODE    upsampling interpolation   0..2
+ *                M37_STREAM_FMT       buffered output format     0..2
+ *                M37_DECIM            decimation factor of       1..0xffff
+ *                                     current ch.
+ *                M37_DRV_RING         driver ring instead of     0..1
+ *                                     MBUF
+ *                M37_RING_FILL        bytes queued in driver     0..max
+ *                                     ring
+ *                M37_RING_SIZE        size of driver ring        8..max
+ *                M37_RING_LOWWATER    lowwater level of driver   0..size-8
+ *                                     ring [bytes]
+ *                M37_LOW_MARGIN       adaptive lowwater margin   0..size-8
+ *                                     [bytes] (0 = off)
+ *                M37_LOW_MAX          max. adaptive lowwater     0..size-8
+ *                                     level [bytes]
+ *                M37_LOW_LEVEL        effective lowwater level   0..size-8
+ *                                     [bytes]
+ *                M37_LOW_REACT        last refill reaction time  0..max
+ *                                     [msec]
+ *                M37_SEQ_START        current sequencer segment  -1..15
+ *                                      -1 = stopped
+ *                M37_SEQ_BRANCH       pending sequencer branch   0..2
+ *                M37_SEQ_POS          frame in current segment   0..max
+ *                M37_SEQ_PASS         passes of current segment  0..max
+ *                M37_CH_OWN           channels owned by path     0..0xf
+ *                M37_BATCH_RATE       irq rate for batch service 0..max
+ *                M37_BATCH_STATE      batch service active       0..1
+ *                M37_BATCH_SWITCHES   number of switches between 0..max
+ *                                     irq and batch service
+ *                M37_BATCH_SAVED      buffer accesses saved by   0..max
+ *                                     batch service
+ *                M37_IRQ_RATE         measured irq rate [1/s]    0..max
+ *
+ *                M37_BLK_CONFIG returns the current stream configuration
+ *                (M37_CONFIG, all fields valid except sigLow).
+ *
+ *                M37_BLK_STATS returns all counters and states of the
+ *                driver (M37_STATS), captured consistently with one
+ *                interrupt lock. The structure is versioned: fields are
+ *                only appended, 'version' and 'size' tell which fields are
+ *                valid, a shorter buffer gets the leading fields (at least
+ *                version and size). The counters and maxima count since
+ *                the last reset. M37_BLK_STATS_CLR returns the same
+ *                snapshot and resets them (reset-on-read).
+ *
+ *                M37_BLK_TSTAMP returns the recorded commit timestamps
+ *                (M37_TS_REC) oldest first and removes them from the
+ *                timestamp ring. 'seq' is the commit number of the frame,
+ *                as in the output history (M37_BlockRead), 'ts' the time
+ *                of the update strobe in units of M37_TS_RATE. By default
+ *                the timestamps are system ticks (OSS_TickGet), i.e. the
+ *                resolution is one tick (1..10 msec depending on the OS),
+ *                unless the driver is built with another timestamp source
+ *                (TSTAMP_GET). The stamp is the time of the update strobe,
+ *                not of the output: with the external trigger
+ *                (M37_EXT_TRIG) the strobe only loads the values, they are
+ *                output with the next trigger, one trigger period after
+ *                the stamp. The ring holds the last 1024 records, older
+ *                records are overwritten and counted in M37_TS_LOST.
+ *
+ *                M37_BLK_POSITION returns the output position of the
+ *                buffered output (M37_POSITION), captured with one
+ *                interrupt lock, like the hardware pointer of an audio
+ *                driver. 'frames' counts the stream frames taken from the
+ *                output buffer since init, 'queued' the frames written
+ *                but not yet output (M37_FMT_RAW only, the bytes are in
+ *                'queuedBytes' for all formats). Discarded buffer data
+ *                is not counted. 'seq' is the commit number of the last
+ *                stream frame (see M37_BlockRead, M37_BLK_TSTAMP); with
+ *                upsampling each stream frame is committed 'upFactor'
+ *                times. Without underrun, the frame written now is
+ *                output 'queued' stream frames after the last one.
+ *                The MBUF fill is not known while M37_BlockWrite writes
+ *                to MBUF (it may block until the buffer has room): then
+ *                'fillValid' is 0 and 'queued'/'queuedBytes' hold the
+ *                prefetched and partially decoded data only. With the
+ *                driver ring (M37_DRV_RING) the fill is always valid.
+ *
+ *                M37_BLK_ID_INFO returns the identification of the module
+ *                in one call (M37_ID_INFO): the ID PROM image and its
+ *                words magic, module ID, revision and serial number, the
+ *                checksum (16-bit sum of the words, M37_ID_CSUM) and the
+ *                PLD ident. Like M_LL_BLK_ID_DATA, it is served from the
+ *                cached image without accessing the PROM.
+ *
+ *                M37_BLK_BUS_STAT returns the number of bus reads and
+ *                writes of the driver per path (M37_BUS_STAT, index
+ *                M37_BUS_xxx). The counters are cleared with
+ *                M37_BUS_STAT_CLR.
+ *
+ *                M37_BLK_TRACE returns the recorded events (M37_TRACE_REC)
+ *                oldest first and removes them from the trace ring. When
+ *                the ring is full, the oldest records are overwritten;
+ *                lost records show as gaps in the sequence numbers.
+ *
+ *                M37_BLK_SCHED_LATE returns the M37_SCHED_LATE records of
+ *                the setpoints applied since the last call, oldest first.
+ *                The driver keeps the last 64 records.
  *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl             low-level handle
@@ -879,6 +2220,7 @@ static int32 M37_GetStat(
 	int32 error = ERR_SUCCESS;
 
     DBGWRT_1((DBH, "%s: ch=%d code=0x%04x\n",functionName,ch,code));
+	llHdl->busPath = M37_BUS_OTHER;
 
     switch(code)
     {
@@ -941,8 +2283,10 @@ static int32 M37_GetStat(
 			if (blk->size < MOD_ID_SIZE)		/* check buf size */
 				return(ERR_LL_USERBUF);
 
-			for (n=0; n<MOD_ID_SIZE/2; n++)		/* read MOD_ID_SIZE/2 words */
-				*dataP++ = (int16)m_read((U_INT32_OR_64)llHdl->ma, n);
+			if (!llHdl->idValid)
+				IdRead(llHdl);
+			for (n=0; n<MOD_ID_SIZE/2; n++)		/* copy MOD_ID_SIZE/2 words */
+				*dataP++ = llHdl->idData[n];
 
 			break;
 		}
@@ -963,8 +2307,337 @@ static int32 M37_GetStat(
         |  power supply             |
         +--------------------------*/
 		case M37_PWR_SUPPL:
-			*valueP =(( MREAD_D16(llHdl->ma,STAT_REG) & PWR ) ? 1 : 0 );
+			/* status snapshot, read again when too old */
+			if (OSS_TickGet(llHdl->osHdl) - llHdl->statTick <=
+				llHdl->statMaxTicks)
+				*valueP = ( (llHdl->statSnap & PWR) ? 1 : 0 );
+			else
+				*valueP = ( (StatReadLocked(llHdl) & PWR) ? 1 : 0 );
+			break;
+		case M37_STAT_MAXAGE:
+			*valueP = (int32)llHdl->statMaxAge;
+			break;
+		case M37_PWR_RECOVER:
+			*valueP = (int32)llHdl->pwrRcvMode;
+			break;
+		case M37_PWR_RCV_COUNT:
+			*valueP = (int32)llHdl->pwrRcvs;
+			break;
+		case M37_PWR_RCV_TIME:
+			*valueP = (int32)(llHdl->pwrRcvTime * 1000 /
+							  OSS_TickRateGet(llHdl->osHdl));
+			break;
+        /*--------------------------+
+        |  trace                    |
+        +--------------------------*/
+		case M37_TRACE_MASK:
+			*valueP = (int32)llHdl->trcMask;
+			break;
+		case M37_TRACE_RATE:
+			*valueP = OSS_TickRateGet(llHdl->osHdl);
+			break;
+        /*--------------------------+
+        |  data register access     |
+        +--------------------------*/
+		case M37_ACCESS_D32:
+			*valueP = (int32)llHdl->d32;
+			break;
+        /*--------------------------+
+        |  sequencer                |
+        +--------------------------*/
+		case M37_SEQ_START:
+			*valueP = llHdl->seqCur;
+			break;
+		case M37_SEQ_BRANCH:
+			*valueP = (int32)llHdl->seqBranch;
+			break;
+		case M37_SEQ_POS:
+			*valueP = (int32)llHdl->seqPos;
+			break;
+		case M37_SEQ_PASS:
+			*valueP = (int32)llHdl->seqPass;
+			break;
+        /*--------------------------+
+        |  channel owners           |
+        +--------------------------*/
+		case M37_CH_OWN:
+			*valueP = (int32)llHdl->own[ch];
+			break;
+        /*--------------------------+
+        |  batch service            |
+        +--------------------------*/
+		case M37_BATCH_RATE:
+			*valueP = (int32)llHdl->batchRate;
+			break;
+		case M37_BATCH_STATE:
+			*valueP = (int32)llHdl->batchOn;
+			break;
+		case M37_BATCH_SWITCHES:
+			*valueP = (int32)llHdl->batchSwitches;
+			break;
+		case M37_BATCH_SAVED:
+			*valueP = (int32)llHdl->batchSaved;
+			break;
+		case M37_IRQ_RATE:
+			*valueP = (int32)llHdl->irqRate;
+			break;
+		case M37_BLK_CONFIG:
+		{
+			M37_CONFIG	*cfgP = (M37_CONFIG*)blk->data;
+			int32		val;
+
+			if (blk->size < (int32)sizeof(M37_CONFIG)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			if ((error = MBUF_GetBufferMode(llHdl->bufHdl, &val)))
+				break;
+			cfgP->bufMode = val;
+			MBUF_GetStat(NULL, llHdl->bufHdl, M_BUF_WR_LOWWATER, &val);
+			cfgP->bufLow  = val;
+			cfgP->bufTout = llHdl->bufTout;
+			cfgP->sigLow  = 0;
+			cfgP->extTrig = llHdl->extTrig;
+			cfgP->irqEn   = llHdl->irqEn;
+			cfgP->drvRing = llHdl->ringOn;
+			cfgP->fmt     = llHdl->fmt;
+			cfgP->valid   = M37_CFG_ALL & ~M37_CFG_SIGLOW;
+
+			blk->size = sizeof(M37_CONFIG);	/* return size */
+			break;
+		}
+		case M37_BLK_STATS:
+		case M37_BLK_STATS_CLR:
+		{
+			M37_STATS	st;
+
+			if (blk->size < 2 * (int32)sizeof(u_int32)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			StatsGet(llHdl, &st, code == M37_BLK_STATS_CLR);
+			if (blk->size > (int32)sizeof(M37_STATS))
+				blk->size = sizeof(M37_STATS);	/* return size */
+			st.size = blk->size;
+			OSS_MemCopy(llHdl->osHdl, blk->size, (char*)&st, (char*)blk->data);
+			break;
+		}
+		case M37_BLK_POSITION:
+		{
+			OSS_IRQ_STATE	irqState;
+
+			if (blk->size < (int32)sizeof(M37_POSITION)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			PosGet(llHdl, (M37_POSITION*)blk->data);
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			blk->size = sizeof(M37_POSITION);	/* return size */
+			break;
+		}
+		case M37_BLK_ID_INFO:
+		{
+			M37_ID_INFO	*dataP = (M37_ID_INFO*)blk->data;
+			char		*str = M37_PldIdent();
+			u_int32		n;
+
+			if (blk->size < (int32)sizeof(M37_ID_INFO)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			if (!llHdl->idValid)
+				IdRead(llHdl);
+
+			dataP->magic    = llHdl->idData[0];
+			dataP->modId    = llHdl->idData[1];
+			dataP->revision = llHdl->idData[2];
+			dataP->serial   = llHdl->idData[3];
+			dataP->csum     = llHdl->idCsum;
+			dataP->res      = 0;
+			for (n=0; n<sizeof(dataP->pldIdent)-1 && str[n]; n++)
+				dataP->pldIdent[n] = str[n];
+			dataP->pldIdent[n] = '\0';
+			for (n=0; n<MOD_ID_SIZE/2; n++)
+				dataP->data[n] = llHdl->idData[n];
+
+			blk->size = sizeof(M37_ID_INFO);	/* return size */
+			break;
+		}
+		case M37_BLK_BUS_STAT:
+		{
+			M37_BUS_STAT	*dataP = (M37_BUS_STAT*)blk->data;
+			OSS_IRQ_STATE	irqState;
+			u_int32			n;
+
+			if (blk->size < (int32)sizeof(M37_BUS_STAT)) {
+				error = ERR_LL_USERBUF;
+				break;
+			}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			for (n=0; n<BUS_PATHS; n++)  {
+				dataP->rd[n] = llHdl->busRd[n];
+				dataP->wr[n] = llHdl->busWr[n];
+			}
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = sizeof(M37_BUS_STAT);	/* return size */
+			break;
+		}
+		case M37_BLK_TSTAMP:
+		{
+			M37_TS_REC		*dataP = (M37_TS_REC*)blk->data;
+			TS_REC			*recP;
+			OSS_IRQ_STATE	irqState;
+			u_int32			n, nbr = blk->size / sizeof(M37_TS_REC);
+
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			for (n=0; n<nbr && llHdl->tsOut != llHdl->tsIn; n++)  {
+				recP = &llHdl->ts[llHdl->tsOut++ % TS_DEPTH];
+				dataP[n].seq = recP->seq;
+				dataP[n].ts  = recP->ts;
+			}
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = n * sizeof(M37_TS_REC);	/* return size */
+			break;
+		}
+		case M37_BLK_TRACE:
+		{
+			M37_TRACE_REC	*dataP = (M37_TRACE_REC*)blk->data;
+			TRACE_REC		*recP;
+			OSS_IRQ_STATE	irqState;
+			u_int32			n, nbr = blk->size / sizeof(M37_TRACE_REC);
+
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			for (n=0; n<nbr && llHdl->trcOut != llHdl->trcSeq; n++)  {
+				recP = &llHdl->trc[llHdl->trcOut++ % TRACE_DEPTH];
+				dataP[n].tick = recP->tick;
+				dataP[n].seq  = recP->seq;
+				dataP[n].type = recP->type;
+				dataP[n].arg0 = recP->arg0;
+				dataP[n].arg1 = recP->arg1;
+			}
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = n * sizeof(M37_TRACE_REC);	/* return size */
+			break;
+		}
+        /*--------------------------+
+        |  setpoint schedule        |
+        +--------------------------*/
+		case M37_SCHED_CLK:
+			*valueP = (int32)llHdl->schedClk;
+			break;
+		case M37_SCHED_TIME:
+			*valueP = (int32)(llHdl->schedClk == M37_SCHED_CLK_TRIG ?
+							  llHdl->schedTrig : OSS_TickGet(llHdl->osHdl));
+			break;
+		case M37_SCHED_RATE:
+			*valueP = (llHdl->schedClk == M37_SCHED_CLK_TRIG ?
+					   0 : OSS_TickRateGet(llHdl->osHdl));
+			break;
+		case M37_SCHED_COUNT:
+			*valueP = (int32)(llHdl->schedIn - llHdl->schedOut);
+			break;
+		case M37_SCHED_LATE_MAX:
+			*valueP = (int32)llHdl->lateMax;
+			break;
+        /*--------------------------+
+        |  slew limit, ramp         |
+        +--------------------------*/
+		case M37_SLEW_LIMIT:
+			*valueP = (int32)llHdl->slew[ch];
+			break;
+		case M37_RAMP_STATE:
+			*valueP = (llHdl->rampMask & (1<<ch)) ? 1 : 0;
+			break;
+        /*--------------------------+
+        |  upsampling               |
+        +--------------------------*/
+		case M37_UPSAMPLE:
+			*valueP = (int32)llHdl->upFactor;
+			break;
+		case M37_UPSAMPLE_MODE:
+			*valueP = (int32)llHdl->upMode;
+			break;
+        /*--------------------------+
+        |  stream format            |
+        +--------------------------*/
+		case M37_STREAM_FMT:
+			*valueP = (int32)llHdl->fmt;
+			break;
+		case M37_DECIM:
+			*valueP = (int32)llHdl->decim[ch];
+			break;
+        /*--------------------------+
+        |  commit timestamps        |
+        +--------------------------*/
+		case M37_TS_DIV:
+			*valueP = (int32)llHdl->tsDiv;
+			break;
+		case M37_TS_RATE:
+			*valueP = (int32)TSTAMP_RATE(llHdl);
+			break;
+		case M37_TS_LOST:
+			*valueP = (int32)llHdl->tsLost;
+			break;
+        /*--------------------------+
+        |  ID PROM cache            |
+        +--------------------------*/
+		case M37_ID_CSUM:
+			if (!llHdl->idValid)
+				IdRead(llHdl);
+			*valueP = (int32)llHdl->idCsum;
+			break;
+        /*--------------------------+
+        |  driver ring              |
+        +--------------------------*/
+		case M37_DRV_RING:
+			*valueP = (int32)llHdl->ringOn;
+			break;
+		case M37_RING_FILL:
+			*valueP = (int32)(llHdl->ringIdx.head - llHdl->ringIdx.tail);
+			break;
+		case M37_RING_SIZE:
+			*valueP = (int32)llHdl->ringSize;
+			break;
+		case M37_RING_LOWWATER:
+			*valueP = (int32)llHdl->ringLow;
+			break;
+        /*--------------------------+
+        |  adaptive lowwater        |
+        +--------------------------*/
+		case M37_LOW_MARGIN:
+			*valueP = (int32)llHdl->lowMargin;
+			break;
+		case M37_LOW_MAX:
+			*valueP = (int32)llHdl->lowMax;
+			break;
+		case M37_LOW_LEVEL:
+			*valueP = (int32)(llHdl->ringOn ? llHdl->ringLow : llHdl->bufLow);
+			break;
+		case M37_LOW_REACT:
+			*valueP = (int32)(llHdl->lowReact * 1000 /
+							  OSS_TickRateGet(llHdl->osHdl));
+			break;
+		case M37_BLK_SCHED_LATE:
+		{
+			M37_SCHED_LATE	*dataP = (M37_SCHED_LATE*)blk->data;
+			OSS_IRQ_STATE	irqState;
+			u_int32			n, nbr = blk->size / sizeof(M37_SCHED_LATE);
+
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			for (n=0; n<nbr && llHdl->lateOut != llHdl->lateIn; n++)  {
+				dataP[n].time = llHdl->late[llHdl->lateOut % SCHED_DEPTH].time;
+				dataP[n].late = llHdl->late[llHdl->lateOut % SCHED_DEPTH].late;
+				llHdl->lateOut++;
+			}
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = n * sizeof(M37_SCHED_LATE);	/* return size */
 			break;
+		}
 		/*--------------------------+
         |  MBUF + (unknown)         |
         +--------------------------*/
@@ -981,8 +2654,13 @@ static int32 M37_GetStat(
  *
  *  Description:  Read a data block from the device
  *
- *                The function is not supported and always returns an 
- *                ERR_LL_ILL_FUNC error.
+ *                The function returns the output history: the last
+ *                committed frames (M37_HIST_REC), oldest first, as many as
+ *                fit into the buffer (max. 256). Every update strobe of
+ *                the driver records one frame with its commit number and
+ *                system tick. The history is not removed by reading; the
+ *                commit numbers identify frames already read.
+ *                The hardware is not accessed.
  *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl        low-level handle
@@ -1002,12 +2680,38 @@ static int32 M37_BlockRead(
 )
 {
     DBGCMD( static const char functionName[] = "LL - M37_BlockRead"; )
+	M37_HIST_REC	*recP = (M37_HIST_REC*)buf;
+	u_int32			n, nbr, seq, i;
+	OSS_IRQ_STATE	irqState;
+
     DBGWRT_1((DBH, "%s: ch=%d, size=%d\n", functionName,ch,size));
 
 	/* return number of read bytes */
 	*nbrRdBytesP = 0;
-	
-	return(ERR_LL_ILL_FUNC);
+
+	if (size < (int32)sizeof(M37_HIST_REC))
+		return(ERR_LL_USERBUF);
+
+	/* last nbr records (locked against ISR) */
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	nbr = size / sizeof(M37_HIST_REC);
+	if (nbr > HIST_DEPTH)
+		nbr = HIST_DEPTH;
+	if (nbr > llHdl->histSeq)
+		nbr = llHdl->histSeq;
+	seq = llHdl->histSeq - nbr;
+
+	for (n=0; n<nbr; n++, seq++) {
+		HIST_REC *histP = &llHdl->hist[seq % HIST_DEPTH];
+		recP[n].seq  = histP->seq;
+		recP[n].tick = histP->tick;
+		for (i=0; i<CH_NUMBER; i++)
+			recP[n].val[i] = histP->val[i];
+	}
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	*nbrRdBytesP = nbr * sizeof(M37_HIST_REC);
+	return(ERR_SUCCESS);
 }
 
 /****************************** M37_BlockWrite *******************************
@@ -1043,6 +2747,15 @@ static int32 M37_BlockRead(
  *                buffer when the interrupt is enabled.
  *                The buffer is written to the channels in ISR.
  *                The power supply to the analog circuit is not verified.   
+ *
+ *                After a power supply failure, the function fails
+ *                immediately (ERR_LL_DEV_NOTRDY) until the status register
+ *                shows the supply again.
+ *
+ *                With the driver ring (M37_DRV_RING), the data is copied
+ *                to the free space of the ring and published with one index
+ *                update. When the ring is full, the function waits for
+ *                space (M_BUF_WR_TIMEOUT).
  *                
  *                +---------------+
  *                | word 0 chan 0 |
@@ -1059,7 +2772,39 @@ static int32 M37_BlockRead(
  *                +---------------+
  *                | word n chan 3 |
  *                +---------------+
- *                
+ *
+ *                With the delta format (M37_STREAM_FMT = M37_FMT_DELTA),
+ *                the data buffer is a byte stream of frames which is
+ *                decoded in the ISR. A frame is either
+ *                - 4 signed bytes: the deltas of chan 0..3 to the previous
+ *                  frame (the byte of chan 0 must not be 0x80 or 0x81), or
+ *                - a keyframe: M37_DELTA_KEY (0x80) followed by the 4 words
+ *                  of chan 0..3.
+ *                M37_DELTA_PAD (0x81) bytes between frames are ignored and
+ *                can be used to pad the buffer to a multiple of 8 bytes.
+ *                Frames may span several M37_BlockWrite calls.
+ *
+ *                With the decimated format (M37_STREAM_FMT = M37_FMT_DECIM),
+ *                a frame holds only the words of the channels due in this
+ *                frame, in ascending order. A channel with decimation
+ *                factor N (M37_DECIM) is due in the first frame and in
+ *                every Nth frame after it, and holds its value in between.
+ *                E.g. chan 0 with N=1 and chan 1..3 with N=200: frame 0
+ *                holds 4 words, frames 1..199 one word (chan 0), frame 200
+ *                again 4 words. Frames may span several M37_BlockWrite
+ *                calls, the block size is still a multiple of 8 bytes.
+ *
+ *                Channel Owner (M37_CH_OWN)
+ *                --------------------------
+ *                When the current channel owns channels, the buffer holds
+ *                one word per owned channel in ascending order (e.g. chan 2,
+ *                chan 3). The words replace the latest-value slots of the
+ *                channels, the function doesn't wait. With the interrupt
+ *                flag enabled, the ISR merges the slots into the next frame
+ *                (one update strobe for all owners). Otherwise the merged
+ *                frame is written at once, which requires the external
+ *                trigger to be disabled (else ERR_LL_ILL_PARAM).
+ *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl        low-level handle
  *                ch           current channel
@@ -1078,16 +2823,27 @@ static int32 M37_BlockWrite(
 )
 {
     DBGCMD( static const char functionName[] = "LL - M37_BlockWrite"; )
-	u_int32		n;
+	u_int32		n, start;
 	int32		error, bufMode;
 	u_int16		*bufP = (u_int16*) buf;
 	u_int16		helpreg;
+	OSS_IRQ_STATE irqState;
 
 	DBGWRT_1((DBH, "%s: ch=%d, size=%d\n", functionName,ch,size));
+	llHdl->busPath = M37_BUS_BLKWRITE;
 
 	/* get current buffer mode */
 	if  (( error = MBUF_GetBufferMode(llHdl->bufHdl, &bufMode)))
 		return(error);
+	TRACE_LOCKED(llHdl, M37_TRC_BLKWRITE, bufMode, size);
+
+	/* fail fast after power supply failure (one recheck), recover */
+	if (llHdl->pwrLost && (error = PwrRecover(llHdl)))
+		return(error);
+
+	/* channel owner: write value slots */
+	if (llHdl->own[ch])
+		return( OwnWrite(llHdl, ch, bufP, size, nbrWrBytesP) );
 
 	/*----------------------+
 	| write to hardware     |
@@ -1101,14 +2857,16 @@ static int32 M37_BlockWrite(
 		if( size != (CH_BYTES * CH_NUMBER) )
 			return (ERR_LL_USERBUF);
 		
-		/* write to channels */
-		for (n=0; n<CH_NUMBER; n++) {
+		/* write to channels (locked against schedule timer) */
+		irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+		for (n=0; n<CH_NUMBER; n++)
 			llHdl->chanVal[n] = *bufP++;		/* update value for current channel */
-			MWRITE_D16(llHdl->ma, DATA_REG(n), llHdl->chanVal[n]);
-		}
-		MSETMASK_D16 ( llHdl->ma, CONF_REG, UD);			/*update*/	
+		OwnMerge(llHdl);					/* owned channels keep their slot */
+		CommitFrame(llHdl);
+		llHdl->hwFull = 2;		/* buffer half not verified (BUFRDY) */
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
 		do  { 	/* wait for buffer ready or break if power supply fails */   
-			helpreg = MREAD_D16(llHdl->ma,STAT_REG);
+			helpreg = StatReadLocked(llHdl);
 			if (!(helpreg & PWR))  {	/* check power supply to analog part */
 				DBGWRT_ERR((DBH," *** %s: PWR fails\n", functionName));
 				return(ERR_LL_DEV_NOTRDY);
@@ -1127,17 +2885,24 @@ static int32 M37_BlockWrite(
 		if( !size || (size%(CH_BYTES * CH_NUMBER)) )
 			return (ERR_LL_USERBUF);
 
+		if (llHdl->lowEvent)		/* refill after lowwater event */
+			LowAdapt(llHdl);
+
+		if (llHdl->ringOn)			/* driver ring */
+			return( RingWrite(llHdl, (u_int8*)bufP, size, nbrWrBytesP) );
+
 		/* enable interrupt on hardware */
 		llHdl->irqOn = TRUE;		/* until all values are written */
-		helpreg = MREAD_D16(llHdl->ma, STAT_REG) & ~UD;		
-		MWRITE_D16(llHdl->ma, CONF_REG, (helpreg | IRQE) );
+		ConfWriteLocked(llHdl, IRQE, 0);
 
-		if ((error = MBUF_Write(llHdl->bufHdl, (u_int8*)bufP, size,
-										nbrWrBytesP)))     {
-			llHdl->irqOn = FALSE;		/* disable irq in isr */
-			return(error);		
-		}
+		start = OSS_TickGet(llHdl->osHdl);
+		error = MBUF_Write(llHdl->bufHdl, (u_int8*)bufP, size, nbrWrBytesP);
+		irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+		FillUpdate(llHdl, *nbrWrBytesP, start);
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
 		llHdl->irqOn = FALSE;		/* disable irq in isr */
+		if (error)
+			return(error);
 	}
 	return(ERR_SUCCESS);
 }
@@ -1167,6 +2932,22 @@ static int32 M37_BlockWrite(
  *                to M37_BlockWrite was written, the last values are written until
  *                the output buffer is filled again.
  *
+ *                With upsampling (M37_UPSAMPLE), a new frame is taken from
+ *                the output buffer every n-th interrupt and the frames in
+ *                between are interpolated.
+ *
+ *                When the interrupt rate reaches M37_BATCH_RATE, the ISR
+ *                switches to batch service: the buffered data is prefetched
+ *                in units of 32 frames, so the buffer is accessed once per
+ *                32 interrupts. The hardware buffers only one frame, so
+ *                every frame still needs its interrupt.
+ *
+ *                With the trigger clock (M37_SCHED_CLK_TRIG), each interrupt
+ *                advances the schedule time and the due setpoints are
+ *                applied and the active ramps advanced before the values are
+ *                written. The interrupt stays enabled on the hardware while
+ *                setpoints are queued or ramps are active.
+ *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl    low-level handle
  *  Output.....:  return   LL_IRQ_DEVICE    irq caused by device
@@ -1178,43 +2959,54 @@ static int32 M37_Irq(
 )
 {
     DBGCMD( static const char functionName[] = ">>> LL - M37_Irq"; )
-	u_int32 ch;
-    int32	got;
-	u_int16	*bufP;
+	u_int32	path = llHdl->busPath;		/* interrupted path */
+	u_int16	helpreg;
 
 	IDBGWRT_1((DBH, "%s:\n",functionName));
+	llHdl->busPath = M37_BUS_IRQ;
 	
 	/*---------------------------+ 
 	| interrupt activated by M37 |
 	+---------------------------*/
-	if (!( MREAD_D16(llHdl->ma, STAT_REG) && (IRQE || BUFRDY) ))
+	if (!( (helpreg = StatRead(llHdl)) && (IRQE || BUFRDY) ))  {
+		TRACE(llHdl, M37_TRC_IRQ, 0, helpreg);
+		llHdl->busPath = path;
 		return(LL_IRQ_DEV_NOT);		/* say: not */
+	}
+	TRACE(llHdl, M37_TRC_IRQ, 1, helpreg);
+	BatchCheck(llHdl);
 
 	/*----------------------+
 	| push buffer			|
 	+----------------------*/
-	bufP = (u_int16*)MBUF_GetNextBuf(llHdl->bufHdl, 1, &got);
-	if (bufP != 0)  {
-		for (ch=0; ch<CH_NUMBER; ch++)  {
-			/* push buffer entry */
-			llHdl->chanVal[ch] = *bufP++;
-			MWRITE_D16(llHdl->ma, DATA_REG(ch), llHdl->chanVal[ch]);
-		}
-		MSETMASK_D16 ( llHdl->ma, CONF_REG, UD);			/* update */
-		MBUF_ReadyBuf( llHdl->bufHdl );
-	}
 	/* no valid data in buffer (buffer empty) */
-	else  {
-		if (!llHdl->irqOn)  {   /* not the first time in ISR and MBUF buffer empty */
+	if (!StreamNext(llHdl))  {
+		TRACE(llHdl, M37_TRC_UNDERRUN, 0, llHdl->irqCount);
+		llHdl->underruns++;
+		/* not the first time in ISR, MBUF buffer empty and no
+		   setpoints or ramps waiting for the trigger clock */
+		if (!llHdl->irqOn &&
+			!(llHdl->schedClk == M37_SCHED_CLK_TRIG && ClockBusy(llHdl)))  {
 			/* disable interrupt on hardware */
-			MCLRMASK_D16(llHdl->ma, CONF_REG, (IRQE | UD) );
+			ConfWrite(llHdl, 0, IRQE);
 		}
-		for (ch=0; ch<CH_NUMBER; ch++)  {		/* write the last values again */
-				MWRITE_D16(llHdl->ma, DATA_REG(ch), llHdl->chanVal[ch]);
-		}
-		MSETMASK_D16 ( llHdl->ma, CONF_REG, UD);			/* update */
+		/* the last values are written again */
+	}
+	if (llHdl->lowMargin)
+		LowTrack(llHdl);
+	OwnMerge(llHdl);				/* values of channel owners */
+
+	/*----------------------+
+	| apply schedule, ramps	|
+	+----------------------*/
+	if (llHdl->schedClk == M37_SCHED_CLK_TRIG) {
+		SchedApply(llHdl, ++llHdl->schedTrig);
+		RampAdvance(llHdl);
 	}
+
+	CommitFrame(llHdl);
 	llHdl->irqCount++;
+	llHdl->busPath = path;
 
 	return(LL_IRQ_DEVICE);		/* say: known */
 }
@@ -1279,6 +3071,9 @@ static int32 M37_Info(
 
 			*addrModeP = MDIS_MA08;
 			*dataModeP = MDIS_MD08 | MDIS_MD16;
+#ifdef M37_D32
+			*dataModeP |= MDIS_MD32;
+#endif
 			break;
 	    }
 		/*-------------------------------+
@@ -1307,7 +3102,11 @@ static int32 M37_Info(
 				error = ERR_LL_ILL_PARAM;
 			else {
 				*addrModeP = MDIS_MA08;
+#ifdef M37_D32
+				*dataModeP = MDIS_MD32;		/* data registers (ACCESS_D32) */
+#else
 				*dataModeP = MDIS_MD16;
+#endif
 				*addrSizeP = ADDRSPACE_SIZE;
 			}
 
@@ -1375,6 +3174,8 @@ static int32 Cleanup(
    int32        retCode
 )
 {
+	u_int32	n;
+
     /*------------------------------+
     |  close handles                |
     +------------------------------*/
@@ -1385,6 +3186,28 @@ static int32 Cleanup(
 	/* clean up buffer */
 	if (llHdl->bufHdl)
 		MBUF_Remove(&llHdl->bufHdl);
+
+	/* clean up schedule timer */
+	if (llHdl->alarmHdl)
+		OSS_AlarmRemove(llHdl->osHdl, &llHdl->alarmHdl);
+
+	/* clean up driver ring */
+	if (llHdl->ringSem)
+		OSS_SemRemove(llHdl->osHdl, &llHdl->ringSem);
+	if (llHdl->ringSig)
+		OSS_SigRemove(llHdl->osHdl, &llHdl->ringSig);
+
+	/* clean up power supply signal */
+	if (llHdl->pwrSig)
+		OSS_SigRemove(llHdl->osHdl, &llHdl->pwrSig);
+	if (llHdl->ringBuf)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->ringBuf, llHdl->ringAlloc);
+
+	/* clean up sequencer segments */
+	for (n=0; n<SEQ_SEGS; n++)
+		if (llHdl->seq[n].data)
+			OSS_MemFree(llHdl->osHdl, (int8*)llHdl->seq[n].data,
+						llHdl->seq[n].alloc);
 	
 	/* clean up debug */
 	DBGEXIT((&DBH));
@@ -1455,5 +3278,2104 @@ static void PldLoad(
 	} 
 }
 
-
-
+/******************************** IdRead ************************************
+ *
+ *  Description:  Read the ID PROM image into the cache
+ *
+ *                Reads all MOD_ID_SIZE/2 words with m_read (serial
+ *                EEPROM, some msec) and computes the checksum of the
+ *                image (16-bit sum of the words). The ID PROM defines no
+ *                checksum word, so the sum is information only (e.g. to
+ *                compare images), it is not verified.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void IdRead(
+	LL_HANDLE *llHdl
+)
+{
+	u_int32	n;
+	u_int16	csum = 0;
+
+	for (n=0; n<MOD_ID_SIZE/2; n++) {
+		llHdl->idData[n] = (u_int16)m_read((U_INT32_OR_64)llHdl->ma, n);
+		csum += llHdl->idData[n];
+	}
+	llHdl->idCsum  = csum;
+	llHdl->idValid = TRUE;
+}
+
+/******************************** CommitFrame *******************************
+ *
+ *  Description:  Write the channel store to the data registers and update
+ *                the outputs.
+ *
+ *                Only channels which differ from the data register content
+ *                of the written buffer half are written (hwVal). The
+ *                halves alternate with every update. After a commit which
+ *                is not synchronized to BUFRDY, the caller sets hwFull to 2
+ *                so that both halves are completely rewritten.
+ *                The committed values are stored for readback and in the
+ *                output history. Every M37_TS_DIV commit is timestamped
+ *                right after the update strobe.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void CommitFrame(
+	LL_HANDLE *llHdl
+)
+{
+	u_int16 *v  = llHdl->chanVal;
+	u_int16 *hw = llHdl->hwVal[llHdl->hwHalf];
+	u_int32 ch, chg = 0;
+	HIST_REC *histP;
+	TS_REC	*tsP;
+
+	for (ch=0; ch<CH_NUMBER; ch++)  {
+		if (v[ch] != hw[ch] || llHdl->hwFull) {
+			hw[ch] = v[ch];
+			chg |= 1<<ch;
+		}
+	}
+	if (llHdl->hwFull)
+		llHdl->hwFull--;
+
+	switch (llHdl->d32) {
+		case D32_HI:		/* channel pairs */
+			if (chg & 0x3)
+				REG_WR32(llHdl, DATA_REG(0), ((u_int32)v[0] << 16) | v[1]);
+			if (chg & 0xc)
+				REG_WR32(llHdl, DATA_REG(2), ((u_int32)v[2] << 16) | v[3]);
+			break;
+		case D32_LO:
+			if (chg & 0x3)
+				REG_WR32(llHdl, DATA_REG(0), ((u_int32)v[1] << 16) | v[0]);
+			if (chg & 0xc)
+				REG_WR32(llHdl, DATA_REG(2), ((u_int32)v[3] << 16) | v[2]);
+			break;
+		default:
+			for (ch=0; ch<CH_NUMBER; ch++)
+				if (chg & (1<<ch))
+					REG_WR16(llHdl, DATA_REG(ch), v[ch]);
+	}
+
+	REG_WR16(llHdl, CONF_REG, llHdl->conf | UD);	/* update */
+	llHdl->hwHalf ^= 1;
+
+	/* timestamp */
+	if (llHdl->tsDiv && ++llHdl->tsCnt >= llHdl->tsDiv) {
+		tsP = &llHdl->ts[llHdl->tsIn++ % TS_DEPTH];
+		tsP->ts  = TSTAMP_GET(llHdl);
+		tsP->seq = llHdl->histSeq;
+		llHdl->tsCnt = 0;
+		if (llHdl->tsIn - llHdl->tsOut > TS_DEPTH) {	/* overwritten */
+			llHdl->tsOut = llHdl->tsIn - TS_DEPTH;
+			llHdl->tsLost++;
+		}
+	}
+
+	/* readback, history */
+	histP = &llHdl->hist[llHdl->histSeq % HIST_DEPTH];
+	histP->seq  = llHdl->histSeq++;
+	histP->tick = OSS_TickGet(llHdl->osHdl);
+	for (ch=0; ch<CH_NUMBER; ch++)
+		llHdl->outVal[ch] = histP->val[ch] = v[ch];
+
+	TRACE(llHdl, M37_TRC_COMMIT, 0,
+		  llHdl->chanVal[0] | ((u_int32)llHdl->chanVal[1] << 16));
+}
+
+/******************************** SchedApply ********************************
+ *
+ *  Description:  Apply all setpoints which are due to the channel store
+ *                and record their lateness.
+ *                The caller must commit the channel store and lock against
+ *                the ISR and the schedule timer.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                now		current schedule time
+ *  Output.....:  return	number of applied setpoints
+ *  Globals....:  ---
+ ****************************************************************************/
+static u_int32 SchedApply(
+	LL_HANDLE *llHdl,
+	u_int32 now
+)
+{
+	SCHED_ENTRY	*schedP;
+	SCHED_LATE	*lateP;
+	u_int32		ch, nbr = 0;
+
+	while (llHdl->schedOut != llHdl->schedIn) {
+		schedP = &llHdl->sched[llHdl->schedOut % SCHED_DEPTH];
+		if ((int32)(schedP->time - now) > 0)
+			break;							/* not yet due */
+
+		for (ch=0; ch<CH_NUMBER; ch++)
+			if (schedP->mask & (1<<ch))
+				llHdl->chanVal[ch] = schedP->val[ch];
+
+		/* record lateness (overwrite oldest record) */
+		if (llHdl->lateIn - llHdl->lateOut == SCHED_DEPTH)
+			llHdl->lateOut++;
+		lateP = &llHdl->late[llHdl->lateIn++ % SCHED_DEPTH];
+		lateP->time = schedP->time;
+		lateP->late = now - schedP->time;
+		if (lateP->late > llHdl->lateMax)
+			llHdl->lateMax = lateP->late;
+
+		llHdl->schedOut++;
+		nbr++;
+	}
+	return(nbr);
+}
+
+/******************************** RampStart *********************************
+ *
+ *  Description:  Start a ramp of a channel from its current value
+ *
+ *                The ramp reaches the target within 'steps' clock ticks or,
+ *                with steps=0, moves by max. 'maxStep' per tick. The step
+ *                is restricted to the slew limit of the channel.
+ *                The caller must lock against the ISR and the schedule timer.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                ch		channel
+ *                target	target value
+ *                steps		duration [clock ticks] or 0
+ *                maxStep	max. step per clock tick
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void RampStart(
+	LL_HANDLE *llHdl,
+	int32 ch,
+	u_int16 target,
+	u_int32 steps,
+	u_int32 maxStep
+)
+{
+	RAMP	*rampP = &llHdl->ramp[ch];
+	u_int32	dist;
+
+	rampP->cur    = (int16)llHdl->chanVal[ch];
+	rampP->target = (int16)target;
+	dist = (u_int32)(rampP->target > rampP->cur ?
+					 rampP->target - rampP->cur : rampP->cur - rampP->target);
+
+	if (steps) {				/* duration: dist/steps per tick */
+		rampP->inc = dist / steps;
+		rampP->rem = dist % steps;
+		rampP->div = steps;
+	}
+	else {						/* rate */
+		rampP->inc = maxStep;
+		rampP->rem = 0;
+		rampP->div = 1;
+	}
+	rampP->acc = 0;
+
+	/* apply slew limit */
+	if (llHdl->slew[ch] &&
+		(rampP->inc > llHdl->slew[ch] ||
+		 (rampP->inc == llHdl->slew[ch] && rampP->rem)))  {
+		rampP->inc = llHdl->slew[ch];
+		rampP->rem = 0;
+	}
+
+	if (dist)
+		llHdl->rampMask |= (1<<ch);
+	else
+		llHdl->rampMask &= ~(1<<ch);
+}
+
+/******************************** RampAdvance *******************************
+ *
+ *  Description:  Advance all active ramps by one clock tick and update the
+ *                channel store.
+ *                The caller must commit the channel store and lock against
+ *                the ISR and the schedule timer.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  return	mask of advanced channels
+ *  Globals....:  ---
+ ****************************************************************************/
+static u_int32 RampAdvance(
+	LL_HANDLE *llHdl
+)
+{
+	RAMP	*rampP;
+	u_int32	ch, step, mask = llHdl->rampMask;
+
+	for (ch=0; ch<CH_NUMBER; ch++) {
+		if (!(mask & (1<<ch)))
+			continue;
+		rampP = &llHdl->ramp[ch];
+
+		step = rampP->inc;
+		rampP->acc += rampP->rem;
+		if (rampP->acc >= rampP->div) {
+			rampP->acc -= rampP->div;
+			step++;
+		}
+
+		if (rampP->target > rampP->cur)
+			rampP->cur = ((u_int32)(rampP->target - rampP->cur) > step) ?
+				rampP->cur + (int32)step : rampP->target;
+		else
+			rampP->cur = ((u_int32)(rampP->cur - rampP->target) > step) ?
+				rampP->cur - (int32)step : rampP->target;
+
+		llHdl->chanVal[ch] = (u_int16)rampP->cur;
+		if (rampP->cur == rampP->target)
+			llHdl->rampMask &= ~(1<<ch);		/* done */
+	}
+	return(mask);
+}
+
+/******************************** StreamNext ********************************
+ *
+ *  Description:  Get the next output frame of the buffered output into the
+ *                channel store
+ *
+ *                Without upsampling, the next frame of the output buffer
+ *                is taken. With upsampling, a new frame is taken at phase 0
+ *                and the output frame is interpolated from the last input
+ *                frames. After the last input frame, the interpolation
+ *                continues with the last frame until its delay has passed.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  return	TRUE if a frame was stored, FALSE if the
+ *                          output buffer is empty
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 StreamNext(
+	LL_HANDLE *llHdl
+)
+{
+	int32	got, acc, (*h)[CH_NUMBER] = llHdl->upHist, *c;
+	u_int32	ch, n;
+	u_int16	frame[CH_NUMBER];
+
+	/* new input frame */
+	if (llHdl->upPhase == 0) {
+		got = StreamRead(llHdl, frame);
+
+		if (llHdl->upFactor == 1) {			/* no upsampling */
+			if (!got)
+				return(FALSE);
+			for (ch=0; ch<CH_NUMBER; ch++)
+				llHdl->chanVal[ch] = frame[ch];
+			return(TRUE);
+		}
+
+		if (!got && !llHdl->upTail) {		/* buffer empty, tail done */
+			llHdl->upIdle = TRUE;
+			return(FALSE);
+		}
+
+		/* (re)start at the current output values */
+		if (llHdl->upIdle) {
+			for (n=0; n<4; n++)
+				for (ch=0; ch<CH_NUMBER; ch++)
+					h[n][ch] = (int16)llHdl->chanVal[ch];
+			llHdl->upIdle = FALSE;
+		}
+
+		/* shift history, append input frame or repeat the last one */
+		for (n=0; n<3; n++)
+			for (ch=0; ch<CH_NUMBER; ch++)
+				h[n][ch] = h[n+1][ch];
+
+		if (got) {
+			for (ch=0; ch<CH_NUMBER; ch++)
+				h[3][ch] = (int16)frame[ch];
+			llHdl->upTail = (llHdl->upMode == M37_UPS_FIR ? 3 :
+							 llHdl->upMode == M37_UPS_LINEAR ? 1 : 0);
+		}
+		else
+			llHdl->upTail--;
+	}
+
+	/* interpolate */
+	for (ch=0; ch<CH_NUMBER; ch++) {
+		switch (llHdl->upMode) {
+		case M37_UPS_LINEAR:	/* h2 -> h3 */
+			acc = h[2][ch] + ((h[3][ch] - h[2][ch]) * (int32)llHdl->upPhase) /
+				(int32)llHdl->upFactor;
+			break;
+		case M37_UPS_FIR:		/* h1 -> h2 */
+			c = llHdl->upCoef[llHdl->upPhase];
+			acc = (c[0]*h[0][ch] + c[1]*h[1][ch] + c[2]*h[2][ch] +
+				   c[3]*h[3][ch] + (1<<(UPS_FRAC-1))) >> UPS_FRAC;
+			if (acc > 0x7fff)
+				acc = 0x7fff;
+			else if (acc < -0x8000)
+				acc = -0x8000;
+			break;
+		default:				/* hold h3 */
+			acc = h[3][ch];
+		}
+		llHdl->chanVal[ch] = (u_int16)acc;
+	}
+
+	if (++llHdl->upPhase == llHdl->upFactor)
+		llHdl->upPhase = 0;
+
+	return(TRUE);
+}
+
+/******************************** StreamRead ********************************
+ *
+ *  Description:  Read the next frame from the output buffer
+ *
+ *                While the sequencer runs, the frame is taken from the
+ *                current segment instead.
+ *                M37_FMT_RAW: takes the next buffer unit (4 words).
+ *                M37_FMT_DELTA/M37_FMT_DECIM: collects the bytes of the
+ *                next frame from the buffer units and decodes it. When the
+ *                buffer runs empty within a frame, the collected bytes are
+ *                kept for the next call. With M37_FMT_DECIM, the channels
+ *                which are not due keep their last value.
+ *                Frames from the buffer are counted for M37_BLK_POSITION.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  frame		values of channel 0..3
+ *                return	TRUE if a frame was read, FALSE if the output
+ *                          buffer is empty
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 StreamRead(
+	LL_HANDLE *llHdl,
+	u_int16 *frame
+)
+{
+	u_int32	ch, need;
+	u_int8	b;
+
+	if (llHdl->seqCur != M37_SEQ_NONE && SeqRead(llHdl, frame))
+		return(TRUE);
+
+	if (llHdl->fmt == M37_FMT_RAW) {
+		if (!UnitGet(llHdl, (u_int8*)frame))
+			return(FALSE);
+		llHdl->posFrames++;
+		llHdl->posSeq = llHdl->histSeq;
+		return(TRUE);
+	}
+
+	/* collect bytes of next frame */
+	for (;;) {
+		if (llHdl->fmt == M37_FMT_DECIM)
+			need = llHdl->decNeed;
+		else
+			need = (llHdl->decLen && llHdl->decBuf[0] == M37_DELTA_KEY) ?
+				1 + CH_BYTES*CH_NUMBER : CH_NUMBER;
+		if (llHdl->decLen == need)
+			break;
+
+		if (llHdl->unitPos == llHdl->unitLen) {		/* next buffer unit */
+			if (!UnitGet(llHdl, llHdl->unitBuf))
+				return(FALSE);
+			llHdl->unitPos = 0;
+			llHdl->unitLen = CH_BYTES*CH_NUMBER;
+		}
+
+		b = llHdl->unitBuf[llHdl->unitPos++];
+		if (llHdl->decLen == 0 && b == M37_DELTA_PAD &&
+			llHdl->fmt == M37_FMT_DELTA)
+			continue;
+		llHdl->decBuf[llHdl->decLen++] = b;
+	}
+
+	/* decode */
+	if (llHdl->fmt == M37_FMT_DECIM) {
+		for (ch=0, need=0; ch<CH_NUMBER; ch++) {
+			if (llHdl->decDue & (1<<ch)) {			/* due (host order) */
+				((u_int8*)&llHdl->decVal[ch])[0] = llHdl->decBuf[need++];
+				((u_int8*)&llHdl->decVal[ch])[1] = llHdl->decBuf[need++];
+			}
+			frame[ch] = llHdl->decVal[ch];
+		}
+		DecimStep(llHdl, FALSE);
+	}
+	else {
+		for (ch=0; ch<CH_NUMBER; ch++) {
+			if (llHdl->decBuf[0] == M37_DELTA_KEY) {	/* keyframe (host order) */
+				((u_int8*)&llHdl->decVal[ch])[0] = llHdl->decBuf[1 + 2*ch];
+				((u_int8*)&llHdl->decVal[ch])[1] = llHdl->decBuf[2 + 2*ch];
+			}
+			else
+				llHdl->decVal[ch] += (int8)llHdl->decBuf[ch];
+			frame[ch] = llHdl->decVal[ch];
+		}
+	}
+	llHdl->decLen = 0;
+	llHdl->posFrames++;
+	llHdl->posSeq = llHdl->histSeq;
+
+	return(TRUE);
+}
+
+/******************************** UnitGet ***********************************
+ *
+ *  Description:  Take the next unit (8 bytes) from the output buffer
+ *
+ *                Reads from the MBUF buffer or, without locks, from the
+ *                driver ring. A writer waiting for ring space is woken,
+ *                the lowwater signal is sent when the ring runs low.
+ *                With batch service, the units are taken from the
+ *                prefetched units, which are refilled when empty.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  unit		unit data
+ *                return	TRUE if a unit was read, FALSE if the output
+ *                          buffer is empty
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 UnitGet(
+	LL_HANDLE *llHdl,
+	u_int8 *unit
+)
+{
+	int32	got;
+	u_int32	n, tail;
+	u_int8	*bufP;
+
+	/* prefetched units (also after switching batch service off) */
+	if (llHdl->pfPos < llHdl->pfLen || (llHdl->batchOn && UnitFetch(llHdl))) {
+		bufP = llHdl->pfBuf[llHdl->pfPos++];
+		for (n=0; n<CH_BYTES*CH_NUMBER; n++)
+			unit[n] = bufP[n];
+		llHdl->bufOut += CH_BYTES*CH_NUMBER;
+		return(TRUE);
+	}
+	if (llHdl->batchOn)
+		return(FALSE);					/* buffer empty */
+
+	if (!llHdl->ringOn) {
+		if ((bufP = (u_int8*)MBUF_GetNextBuf(llHdl->bufHdl, 1, &got)) == 0)
+			return(FALSE);
+		for (n=0; n<CH_BYTES*CH_NUMBER; n++)
+			unit[n] = bufP[n];
+		MBUF_ReadyBuf( llHdl->bufHdl );
+		llHdl->bufOut += CH_BYTES*CH_NUMBER;
+		return(TRUE);
+	}
+
+	tail = llHdl->ringIdx.tail;
+	if (llHdl->ringIdx.head == tail)
+		return(FALSE);
+	RING_BARRIER();						/* read data after head */
+
+	bufP = llHdl->ringBuf + (tail & (llHdl->ringSize - 1));
+	for (n=0; n<CH_BYTES*CH_NUMBER; n++)
+		unit[n] = bufP[n];
+
+	RingRelease(llHdl, tail + CH_BYTES*CH_NUMBER);
+	llHdl->bufOut += CH_BYTES*CH_NUMBER;
+	return(TRUE);
+}
+
+/******************************** UnitFetch *********************************
+ *
+ *  Description:  Prefetch up to PF_UNITS units from the output buffer
+ *                (batch service)
+ *
+ *                Takes the units with one MBUF call or one driver ring
+ *                index update instead of one per interrupt.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  return	number of prefetched units (0 = buffer empty)
+ *  Globals....:  ---
+ ****************************************************************************/
+static u_int32 UnitFetch(
+	LL_HANDLE *llHdl
+)
+{
+	int32	got;
+	u_int32	n, tail;
+	u_int8	*bufP;
+
+	if (!llHdl->ringOn) {
+		if ((bufP = (u_int8*)MBUF_GetNextBuf(llHdl->bufHdl, PF_UNITS, &got)) == 0)
+			return(0);
+		n = (u_int32)got;
+		OSS_MemCopy(llHdl->osHdl, n * CH_BYTES*CH_NUMBER, (char*)bufP,
+					(char*)llHdl->pfBuf);
+		MBUF_ReadyBuf( llHdl->bufHdl );
+	}
+	else {
+		tail = llHdl->ringIdx.tail;
+		n = (llHdl->ringIdx.head - tail) / (CH_BYTES*CH_NUMBER);
+		if (n == 0)
+			return(0);
+		if (n > PF_UNITS)
+			n = PF_UNITS;
+		RING_BARRIER();					/* read data after head */
+
+		for (got=0; got<(int32)n; got++) {	/* units don't wrap */
+			bufP = llHdl->ringBuf + (tail & (llHdl->ringSize - 1));
+			OSS_MemCopy(llHdl->osHdl, CH_BYTES*CH_NUMBER, (char*)bufP,
+						(char*)llHdl->pfBuf[got]);
+			tail += CH_BYTES*CH_NUMBER;
+		}
+		RingRelease(llHdl, tail);
+	}
+
+	llHdl->pfPos = 0;
+	llHdl->pfLen = n;
+	llHdl->batchSaved += n - 1;
+	return(n);
+}
+
+/******************************** PfDiscard *********************************
+ *
+ *  Description:  Discard the prefetched units
+ *
+ *                Called when the stream is stopped or reconfigured, so that
+ *                no units of the old stream are output later. The units
+ *                are accounted as taken from the output buffer.
+ *                The caller must lock against the ISR.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void PfDiscard(
+	LL_HANDLE *llHdl
+)
+{
+	llHdl->bufOut += (llHdl->pfLen - llHdl->pfPos) * CH_BYTES*CH_NUMBER;
+	llHdl->pfPos = 0;
+	llHdl->pfLen = 0;
+}
+
+/******************************** RingRelease *******************************
+ *
+ *  Description:  Release read units of the driver ring
+ *
+ *                Wakes a writer waiting for ring space and sends the
+ *                lowwater signal when the ring runs low.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                tail		new read index
+ *  Output.....:  -
+ *  Globals....:  ---
+ ****************************************************************************/
+static void RingRelease(
+	LL_HANDLE *llHdl,
+	u_int32 tail
+)
+{
+	RING_BARRIER();						/* release slots after read */
+	llHdl->ringIdx.tail = tail;
+
+	if (llHdl->ringWait) {
+		llHdl->ringWait = FALSE;
+		OSS_SemSignal(llHdl->osHdl, llHdl->ringSem);
+	}
+	if (llHdl->ringSig && !llHdl->ringLowSent &&
+		llHdl->ringIdx.head - tail <= llHdl->ringLow) {
+		llHdl->ringLowSent = TRUE;
+		OSS_SigSend(llHdl->osHdl, llHdl->ringSig);
+	}
+}
+
+/******************************** BatchCheck ********************************
+ *
+ *  Description:  Measure the interrupt rate and switch batch service
+ *
+ *                Called by the ISR. Every 100ms the interrupt rate is
+ *                computed. Batch service is switched on when the rate
+ *                reaches M37_BATCH_RATE and off when it drops below half
+ *                of it.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  -
+ *  Globals....:  ---
+ ****************************************************************************/
+static void BatchCheck(
+	LL_HANDLE *llHdl
+)
+{
+	u_int32	now = OSS_TickGet(llHdl->osHdl);
+	u_int32	dt  = now - llHdl->rateTick;
+	u_int32	on;
+
+	llHdl->rateCnt++;
+	if (dt < llHdl->rateWin)
+		return;
+
+	llHdl->irqRate  = llHdl->rateCnt * OSS_TickRateGet(llHdl->osHdl) / dt;
+	llHdl->rateTick = now;
+	llHdl->rateCnt  = 0;
+
+	on = llHdl->batchRate &&
+		(llHdl->irqRate >= llHdl->batchRate ||
+		 (llHdl->batchOn && llHdl->irqRate >= llHdl->batchRate / 2));
+	if (on != llHdl->batchOn) {
+		llHdl->batchOn = on;
+		llHdl->batchSwitches++;
+	}
+}
+
+/******************************** RingSet ***********************************
+ *
+ *  Description:  Select MBUF buffer or driver ring for buffered output
+ *
+ *                Allocates the driver ring at first use and discards its
+ *                data. The caller must make sure that the ISR doesn't
+ *                access the buffer.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                ringOn	TRUE for driver ring
+ *  Output.....:  return	success (0) or error code
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 RingSet(
+	LL_HANDLE *llHdl,
+	u_int32 ringOn
+)
+{
+	if (ringOn && !llHdl->ringBuf) {
+		if ((llHdl->ringBuf = (u_int8*)OSS_MemGet(llHdl->osHdl,
+									llHdl->ringSize, &llHdl->ringAlloc)) == NULL)
+			return(ERR_OSS_MEM_ALLOC);
+	}
+
+	llHdl->ringIdx.head = 0;
+	llHdl->ringIdx.tail = 0;
+	llHdl->ringWait = FALSE;
+	llHdl->ringOn   = ringOn;
+	llHdl->pfPos    = 0;				/* discard prefetched units */
+	llHdl->pfLen    = 0;
+	llHdl->bufOut   = llHdl->bufIn;		/* discarded data */
+	llHdl->lowEvent = FALSE;
+	return(ERR_SUCCESS);
+}
+
+/******************************** RingWrite *********************************
+ *
+ *  Description:  Append data to the driver ring
+ *
+ *                Copies as much data as fits into the free space and
+ *                publishes it with one head update, then enables the
+ *                interrupt on the hardware if the ISR has disabled it.
+ *                When the ring is full, the device semaphore is released
+ *                while waiting for the ISR to free space.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl			low-level handle
+ *                buf			data buffer
+ *                size			data buffer size (multiple of 8)
+ *  Output.....:  nbrWrBytesP	number of written bytes
+ *                return		success (0) or error code
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 RingWrite(
+	LL_HANDLE *llHdl,
+	u_int8 *buf,
+	int32 size,
+	int32 *nbrWrBytesP
+)
+{
+	RING_IDX		*idx = &llHdl->ringIdx;
+	u_int32			head = idx->head, done = 0, n, off, part;
+	u_int32			start = OSS_TickGet(llHdl->osHdl);
+	int32			error = ERR_SUCCESS;
+	OSS_IRQ_STATE	irqState;
+
+	while (done < (u_int32)size) {
+		n = llHdl->ringSize - (head - idx->tail);		/* free space */
+		if (n > (u_int32)size - done)
+			n = (u_int32)size - done;
+
+		/* ring full: wait for ISR */
+		if (n == 0) {
+			llHdl->ringWait = TRUE;
+			RING_BARRIER();
+			if (head - idx->tail < llHdl->ringSize)		/* freed meanwhile */
+				continue;
+
+			OSS_SemSignal(llHdl->osHdl, llHdl->devSemHdl);
+			error = OSS_SemWait(llHdl->osHdl, llHdl->ringSem,
+								llHdl->bufTout ? (int32)llHdl->bufTout :
+								OSS_SEM_WAITINF);
+			OSS_SemWait(llHdl->osHdl, llHdl->devSemHdl, OSS_SEM_WAITINF);
+			llHdl->busPath = M37_BUS_BLKWRITE;
+			if (error)
+				break;
+			continue;
+		}
+
+		/* copy (with wrap around), publish */
+		off  = head & (llHdl->ringSize - 1);
+		part = llHdl->ringSize - off;
+		if (part > n)
+			part = n;
+		OSS_MemCopy(llHdl->osHdl, part, (char*)buf + done,
+					(char*)llHdl->ringBuf + off);
+		if (n > part)
+			OSS_MemCopy(llHdl->osHdl, n - part, (char*)buf + done + part,
+						(char*)llHdl->ringBuf);
+
+		RING_BARRIER();							/* data before head */
+		idx->head = head += n;
+		done += n;
+
+		/* enable interrupt on hardware, rearm lowwater (locked against ISR) */
+		irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+		ConfWrite(llHdl, IRQE, 0);
+		if (head - idx->tail > llHdl->ringLow)
+			llHdl->ringLowSent = FALSE;
+		FillUpdate(llHdl, n, start);
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+	}
+
+	*nbrWrBytesP = (int32)done;
+	return(error);
+}
+
+/******************************** StatRead **********************************
+ *
+ *  Description:  Read the status register and update the snapshot
+ *
+ *                A change of the power supply to the analog circuit is
+ *                latched (pwrFail) and signalled. A failure is kept in
+ *                pwrLost until PwrRecover has re-initialized the module.
+ *                With the interrupt flag enabled, a failure also starts
+ *                the recovery by the schedule timer (PwrWatch), because
+ *                stream writers may be blocked and never call PwrRecover.
+ *                The caller must lock against the ISR (or be the ISR),
+ *                see StatReadLocked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  return	status register
+ *  Globals....:  ---
+ ****************************************************************************/
+static u_int16 StatRead(
+	LL_HANDLE *llHdl
+)
+{
+	u_int16	stat = REG_RD16(llHdl, STAT_REG);
+	u_int32	realMsec;
+
+	llHdl->statSnap = stat;
+	llHdl->statTick = OSS_TickGet(llHdl->osHdl);
+
+	if (!(stat & PWR) != !!llHdl->pwrFail) {		/* power supply changed */
+		llHdl->pwrFail = !(stat & PWR);
+		llHdl->pwrFails += llHdl->pwrFail;
+		if (llHdl->pwrFail && !llHdl->pwrLost) {	/* until recovered */
+			llHdl->pwrLost     = TRUE;
+			llHdl->pwrFailTick = llHdl->statTick;
+		}
+		if (llHdl->pwrFail && llHdl->irqEn && !llHdl->pwrWatch) {
+			/* stream writers may block: recover by schedule timer */
+			llHdl->pwrWatch = TRUE;
+			llHdl->pwrStep  = 0;
+			if (!llHdl->alarmOn) {
+				llHdl->alarmOn = TRUE;
+				OSS_AlarmSet(llHdl->osHdl, llHdl->alarmHdl, SCHED_TIMER_MS,
+							 TRUE, &realMsec);
+			}
+		}
+		TRACE(llHdl, M37_TRC_PWR, !llHdl->pwrFail, stat);
+		if (llHdl->pwrSig)
+			OSS_SigSend(llHdl->osHdl, llHdl->pwrSig);
+	}
+	return(stat);
+}
+
+/******************************** StatReadLocked ****************************
+ *
+ *  Description:  Read the status register and update the snapshot, locked
+ *                against the ISR
+ *
+ *                For callers which don't hold the interrupt mask.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  return	status register
+ *  Globals....:  ---
+ ****************************************************************************/
+static u_int16 StatReadLocked(
+	LL_HANDLE *llHdl
+)
+{
+	OSS_IRQ_STATE	irqState;
+	u_int16			stat;
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	stat = StatRead(llHdl);
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	return(stat);
+}
+
+/******************************** PwrRecover ********************************
+ *
+ *  Description:  Check the power supply after a failure and re-initialize
+ *                the module when it has returned
+ *
+ *                Like M37_Init, both buffer halves are written with the
+ *                trigger and interrupt disabled. The channel store keeps
+ *                the last values (M37_PWR_RCV_LAST) or is set to 0V
+ *                (M37_PWR_RCV_SAFE). Then the configuration register is
+ *                restored; the interrupt is also enabled when output data
+ *                is queued. The downtime is counted from the failure.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  return	success (0) or ERR_LL_DEV_NOTRDY
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 PwrRecover(
+	LL_HANDLE *llHdl
+)
+{
+	DBGCMD( static const char functionName[] = "LL - PwrRecover"; )
+	OSS_IRQ_STATE	irqState;
+	u_int16			helpreg;
+	u_int32			half, timeout;
+	int32			error = ERR_SUCCESS;
+
+	if (!(StatReadLocked(llHdl) & PWR))
+		return(ERR_LL_DEV_NOTRDY);
+
+	if (llHdl->pwrRcvMode == M37_PWR_RCV_OFF) {
+		llHdl->pwrLost = FALSE;
+		return(ERR_SUCCESS);
+	}
+	DBGWRT_1((DBH, "%s: re-init\n", functionName));
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	llHdl->pwrWatch = FALSE;			/* take over from schedule timer */
+	llHdl->pwrStep  = 0;
+	PwrSafe(llHdl);
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	for (half=0; half<2 && !error; half++) {
+		irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+		CommitFrame(llHdl);
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+		timeout = 0;
+		do  {	/* wait for buffer ready, break if power fails or timeout */
+			helpreg = StatReadLocked(llHdl);
+			if (!(helpreg & PWR) || timeout++ >= 10) {
+				DBGWRT_ERR((DBH," *** %s: %s\n", functionName,
+							(helpreg & PWR) ? "timeout" : "PWR fails"));
+				error = ERR_LL_DEV_NOTRDY;
+				break;
+			}
+			if (!(helpreg & BUFRDY))
+				OSS_Delay(llHdl->osHdl, 1);
+		} while (!(helpreg & BUFRDY));
+	}
+
+	/* resume trigger mode and buffered output */
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	PwrResume(llHdl, !error);
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	return(error);
+}
+
+/******************************** PwrSafe ***********************************
+ *
+ *  Description:  Disable trigger and interrupt for the power failure
+ *                recovery and prepare the channel store
+ *
+ *                The bits to restore are saved once per recovery. The
+ *                configuration register is written directly, its content
+ *                is lost with the supply. The caller must lock against the
+ *                ISR.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void PwrSafe(
+	LL_HANDLE *llHdl
+)
+{
+	u_int32	ch;
+
+	if (!llHdl->pwrSafe) {
+		llHdl->pwrSafe    = TRUE;
+		llHdl->pwrRestore = llHdl->conf & (IRQE | EE);
+	}
+	llHdl->conf &= ~(IRQE | EE);
+	REG_WR16(llHdl, CONF_REG, llHdl->conf);	/* register lost, no ConfWrite */
+	if (llHdl->pwrRcvMode == M37_PWR_RCV_SAFE) {
+		llHdl->rampMask = 0;
+		for (ch=0; ch<CH_NUMBER; ch++)
+			llHdl->chanVal[ch] = llHdl->slotVal[ch] = 0x0000;
+		PfDiscard(llHdl);				/* no stale units after 0V */
+	}
+	llHdl->hwFull = 2;					/* write all channels to both halves */
+}
+
+/******************************** PwrResume *********************************
+ *
+ *  Description:  Restore the configuration register after the power failure
+ *                recovery and count the recovery
+ *
+ *                The interrupt is also enabled when output data is queued
+ *                or a writer is blocked. The caller must lock against the
+ *                ISR.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                ok		both buffer halves written
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void PwrResume(
+	LL_HANDLE *llHdl,
+	u_int32 ok
+)
+{
+	M37_POSITION	pos;
+	u_int16			restore = llHdl->pwrSafe ? llHdl->pwrRestore : 0;
+
+	PosGet(llHdl, &pos);
+	if (llHdl->irqEn && (pos.queuedBytes || !pos.fillValid ||
+						 llHdl->ringWait || llHdl->seqCur != M37_SEQ_NONE))
+		restore |= IRQE;
+
+	llHdl->pwrSafe = FALSE;
+	llHdl->conf |= restore;
+	REG_WR16(llHdl, CONF_REG, llHdl->conf);
+	if (ok && llHdl->pwrLost) {
+		llHdl->pwrLost    = FALSE;
+		llHdl->pwrRcvTime = OSS_TickGet(llHdl->osHdl) - llHdl->pwrFailTick;
+		if (llHdl->pwrRcvTime > llHdl->pwrRcvMax)
+			llHdl->pwrRcvMax = llHdl->pwrRcvTime;
+		llHdl->pwrRcvs++;
+	}
+}
+
+/******************************** PwrWatch **********************************
+ *
+ *  Description:  Power failure recovery by the schedule timer
+ *
+ *                Started by StatRead when the supply fails with the
+ *                interrupt flag enabled: a writer blocked in MBUF_Write or
+ *                waiting for driver ring space doesn't call PwrRecover and
+ *                would wait forever. Performs the steps of PwrRecover
+ *                without waiting, one per timer tick: when the supply has
+ *                returned, both buffer halves are written (each when
+ *                BUFRDY is set), then the configuration register is
+ *                restored and the ISR resumes the output. A write which
+ *                calls PwrRecover meanwhile takes over.
+ *                Called by the alarm handler (interrupt locked).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void PwrWatch(
+	LL_HANDLE *llHdl
+)
+{
+	u_int16	stat = StatRead(llHdl);
+
+	if (!llHdl->pwrLost) {				/* recovered by a write */
+		llHdl->pwrWatch = FALSE;
+		return;
+	}
+	if (!(stat & PWR)) {				/* still (or again) missing */
+		llHdl->pwrStep = 0;
+		return;
+	}
+	if (llHdl->pwrRcvMode == M37_PWR_RCV_OFF) {
+		llHdl->pwrLost  = FALSE;
+		llHdl->pwrWatch = FALSE;
+		return;
+	}
+
+	if (llHdl->pwrStep == 0)
+		PwrSafe(llHdl);
+	else if (!(stat & BUFRDY))
+		return;							/* wait for buffer ready */
+
+	if (llHdl->pwrStep < 2) {			/* write buffer half */
+		CommitFrame(llHdl);
+		llHdl->pwrStep++;
+		return;
+	}
+	PwrResume(llHdl, TRUE);
+	llHdl->pwrStep  = 0;
+	llHdl->pwrWatch = FALSE;
+}
+
+/******************************** StatMaxAgeSet *****************************
+ *
+ *  Description:  Set the max. age of the status snapshot
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                msec		max. age [msec]
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void StatMaxAgeSet(
+	LL_HANDLE *llHdl,
+	u_int32 msec
+)
+{
+	u_int32	rate = OSS_TickRateGet(llHdl->osHdl);
+
+	llHdl->statMaxAge   = msec;
+	llHdl->statMaxTicks = msec / 1000 * rate + msec % 1000 * rate / 1000;
+}
+
+/******************************** TracePut **********************************
+ *
+ *  Description:  Record an event in the trace ring
+ *
+ *                Overwrites the oldest record when the ring is full.
+ *                Called via TRACE() which checks the event mask.
+ *                The caller must lock against the ISR (or be the ISR),
+ *                see TracePutLocked.
+ *
+ *                The record tick is the system tick (M37_TRACE_RATE,
+ *                typically 1..10 ms resolution), as for the history and
+ *                position ticks. Events within one tick are ordered by
+ *                their sequence number only.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                type		event (M37_TRC_xxx)
+ *                arg0		argument 0
+ *                arg1		argument 1
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void TracePut(
+	LL_HANDLE *llHdl,
+	u_int32 type,
+	u_int32 arg0,
+	u_int32 arg1
+)
+{
+	TRACE_REC	*recP = &llHdl->trc[llHdl->trcSeq % TRACE_DEPTH];
+
+	recP->tick = OSS_TickGet(llHdl->osHdl);
+	recP->seq  = llHdl->trcSeq++;
+	recP->type = (u_int16)type;
+	recP->arg0 = (u_int16)arg0;
+	recP->arg1 = arg1;
+
+	if (llHdl->trcSeq - llHdl->trcOut > TRACE_DEPTH)	/* overwritten */
+		llHdl->trcOut = llHdl->trcSeq - TRACE_DEPTH;
+}
+
+/******************************** TracePutLocked ****************************
+ *
+ *  Description:  Record an event in the trace ring, locked against the ISR
+ *
+ *                For callers which don't hold the interrupt mask, called
+ *                via TRACE_LOCKED().
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                type		event (M37_TRC_xxx)
+ *                arg0		argument 0
+ *                arg1		argument 1
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void TracePutLocked(
+	LL_HANDLE *llHdl,
+	u_int32 type,
+	u_int32 arg0,
+	u_int32 arg1
+)
+{
+	OSS_IRQ_STATE	irqState;
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	TracePut(llHdl, type, arg0, arg1);
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+}
+
+/******************************** ConfWrite *********************************
+ *
+ *  Description:  Change bits of the configuration register
+ *
+ *                The register is written from its shadow (without read)
+ *                and only if the bits change.
+ *                The caller must lock against the ISR (or be the ISR),
+ *                see ConfWriteLocked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                set		bits to set
+ *                clr		bits to clear
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void ConfWrite(
+	LL_HANDLE *llHdl,
+	u_int16 set,
+	u_int16 clr
+)
+{
+	u_int16	conf = (llHdl->conf & ~clr) | set;
+
+	if (conf != llHdl->conf) {
+		llHdl->conf = conf;
+		REG_WR16(llHdl, CONF_REG, conf);
+	}
+}
+
+/******************************** ConfWriteLocked ***************************
+ *
+ *  Description:  Change bits of the configuration register, locked
+ *                against the ISR
+ *
+ *                For callers which don't hold the interrupt mask.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                set		bits to set
+ *                clr		bits to clear
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void ConfWriteLocked(
+	LL_HANDLE *llHdl,
+	u_int16 set,
+	u_int16 clr
+)
+{
+	OSS_IRQ_STATE	irqState;
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	ConfWrite(llHdl, set, clr);
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+}
+
+/******************************** ConfigSet *********************************
+ *
+ *  Description:  Validate and apply a stream configuration (M37_BLK_CONFIG)
+ *
+ *                The fields of cfgP->valid replace the current settings.
+ *                The resulting configuration is checked as a whole before
+ *                anything is changed. Fallible steps (signal, driver ring
+ *                allocation) are done first and undone on error. The ring
+ *                switch is the last of them: switching the ring back would
+ *                discard the queued output.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                cfgP		configuration
+ *  Output.....:  return	success (0) or error code
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 ConfigSet(
+	LL_HANDLE *llHdl,
+	M37_CONFIG *cfgP
+)
+{
+	u_int32	v = cfgP->valid;
+	u_int32	extTrig, irqEn, drvRing, oldRing = llHdl->ringOn;
+	u_int32	oldSig = llHdl->bufSigLow;
+	u_int32	stop, run;
+	int32	bufMode, error;
+	OSS_IRQ_STATE irqState;
+
+	/*----------------------+
+	| resulting config      |
+	+----------------------*/
+	if (v & ~M37_CFG_ALL)
+		return(ERR_LL_ILL_PARAM);
+	if ((error = MBUF_GetBufferMode(llHdl->bufHdl, &bufMode)))
+		return(error);
+
+	if (v & M37_CFG_BUFMODE)
+		bufMode = cfgP->bufMode;
+	extTrig = (v & M37_CFG_EXTTRIG) ? cfgP->extTrig : llHdl->extTrig;
+	irqEn   = (v & M37_CFG_IRQEN)   ? cfgP->irqEn   : llHdl->irqEn;
+	drvRing = (v & M37_CFG_DRVRING) ? cfgP->drvRing : llHdl->ringOn;
+
+	/*----------------------+
+	| validate              |
+	+----------------------*/
+	if ( (bufMode != M_BUF_USRCTRL && bufMode != M_BUF_RINGBUF) ||
+		 (extTrig > 1) || (irqEn > 1) || (drvRing > 1) ||
+		 ((v & M37_CFG_BUFLOW) && (cfgP->bufLow % (CH_BYTES * CH_NUMBER))) ||
+		 ((v & M37_CFG_FMT) && (cfgP->fmt > M37_FMT_DECIM)) )
+		return(ERR_LL_ILL_PARAM);
+
+	/* interrupt flag requires external trigger and M_BUF_RINGBUF */
+	if (irqEn && (!extTrig || bufMode != M_BUF_RINGBUF || !llHdl->mkIrq))
+		return(ERR_LL_ILL_PARAM);
+
+	/*----------------------+
+	| pause stream          |
+	+----------------------*/
+	run  = llHdl->irqEn && (llHdl->conf & IRQE);
+	stop = llHdl->irqEn &&
+		   (v & (M37_CFG_BUFMODE | M37_CFG_EXTTRIG | M37_CFG_IRQEN |
+				 M37_CFG_DRVRING | M37_CFG_FMT));
+	if (stop) {
+		ConfWriteLocked(llHdl, 0, IRQE);
+		llHdl->irqEn = FALSE;
+	}
+
+	/*----------------------+
+	| fallible steps        |
+	+----------------------*/
+	/* MBUF holds one signal: replace, reinstall the old one on error */
+	if ((v & M37_CFG_SIGLOW) && cfgP->sigLow != oldSig) {
+		if (oldSig)
+			MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_SIGCLR_LOW, 0);
+		llHdl->bufSigLow = 0;
+		if (cfgP->sigLow &&
+			(error = MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_SIGSET_LOW,
+								  cfgP->sigLow)))
+			goto undo;
+		llHdl->bufSigLow = cfgP->sigLow;
+	}
+
+	/* last fallible step, the old ring is kept on error */
+	if (drvRing != oldRing && (error = RingSet(llHdl, drvRing)))
+		goto undo;
+
+	/*----------------------+
+	| apply                 |
+	+----------------------*/
+	if (v & M37_CFG_BUFMODE)
+		MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_MODE, bufMode);
+	if (v & M37_CFG_BUFTOUT) {
+		MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_TIMEOUT, cfgP->bufTout);
+		llHdl->bufTout = cfgP->bufTout;
+	}
+	if (v & M37_CFG_BUFLOW) {
+		MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_LOWWATER, cfgP->bufLow);
+		llHdl->bufLow   = cfgP->bufLow;
+		llHdl->lowEvent = FALSE;
+	}
+	if (v & M37_CFG_FMT) {
+		irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+		StreamFmtSet(llHdl, cfgP->fmt);
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+	}
+
+	/* one configuration register write (locked against ISR) */
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	llHdl->extTrig = extTrig;
+	llHdl->irqEn   = irqEn;
+	llHdl->irqOn   = FALSE;
+	if (!irqEn)
+		llHdl->seqCur = M37_SEQ_NONE;		/* stop sequencer */
+	if (stop || !irqEn)
+		PfDiscard(llHdl);					/* units of the old config */
+	ConfWrite(llHdl, (extTrig ? EE : 0) | ((irqEn && run) ? IRQE : 0),
+			  (extTrig ? 0 : EE) | (irqEn ? 0 : IRQE));
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	return(ERR_SUCCESS);
+
+undo:
+	if (llHdl->bufSigLow != oldSig) {
+		if (llHdl->bufSigLow)
+			MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_SIGCLR_LOW, 0);
+		llHdl->bufSigLow = 0;
+		if (oldSig &&
+			!MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_SIGSET_LOW, oldSig))
+			llHdl->bufSigLow = oldSig;		/* else lost */
+	}
+	if (stop) {
+		llHdl->irqEn = TRUE;
+		if (run)
+			ConfWriteLocked(llHdl, IRQE, 0);
+	}
+	return(error);
+}
+
+/******************************** SeqRead ***********************************
+ *
+ *  Description:  Take the next frame of the running sequence
+ *
+ *                After the last frame of a segment pass, the next frame is
+ *                taken from the following segment without a gap: the branch
+ *                segment if a branch is pending, the next segment after
+ *                'repeat' passes, else the same segment again. A branch
+ *                with M37_SEQ_BR_NOW is taken before the frame is read.
+ *                The sequencer stops when it enters a segment without
+ *                frames (or M37_SEQ_NONE).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  frame		values of channel 0..3
+ *                return	TRUE
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 SeqRead(
+	LL_HANDLE *llHdl,
+	u_int16 *frame
+)
+{
+	SEQ_SEG	*segP = &llHdl->seq[llHdl->seqCur];
+	u_int16	*valP;
+	u_int32	ch;
+
+	if (llHdl->seqBranch == M37_SEQ_BR_NOW && segP->branch != M37_SEQ_NONE) {
+		SeqEnter(llHdl, segP->branch);
+		if (llHdl->seqCur == M37_SEQ_NONE)
+			return(FALSE);
+		segP = &llHdl->seq[llHdl->seqCur];
+	}
+
+	valP = segP->data + llHdl->seqPos * CH_NUMBER;
+	for (ch=0; ch<CH_NUMBER; ch++)
+		frame[ch] = valP[ch];
+
+	/* end of pass */
+	if (++llHdl->seqPos == segP->frames) {
+		llHdl->seqPos = 0;
+		llHdl->seqPass++;
+
+		if (llHdl->seqBranch && segP->branch != M37_SEQ_NONE)
+			SeqEnter(llHdl, segP->branch);
+		else if (segP->repeat && llHdl->seqPass >= segP->repeat)
+			SeqEnter(llHdl, segP->next);
+	}
+	return(TRUE);
+}
+
+/******************************** SeqEnter **********************************
+ *
+ *  Description:  Continue the sequence with the given segment
+ *
+ *                Clears a pending branch. Stops the sequencer if the
+ *                segment is M37_SEQ_NONE or has no frames.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                seg		segment (0..M37_SEQ_SEGS-1) or M37_SEQ_NONE
+ *  Output.....:  -
+ *  Globals....:  ---
+ ****************************************************************************/
+static void SeqEnter(
+	LL_HANDLE *llHdl,
+	int32 seg
+)
+{
+	llHdl->seqBranch = M37_SEQ_BR_OFF;
+	llHdl->seqPos    = 0;
+	llHdl->seqPass   = 0;
+
+	if (seg < 0 || seg >= SEQ_SEGS || !llHdl->seq[seg].frames)
+		seg = M37_SEQ_NONE;
+	llHdl->seqCur = seg;
+}
+
+/******************************** SeqLoad ***********************************
+ *
+ *  Description:  Load a sequencer segment (M37_BLK_SEQ_SEG)
+ *
+ *                The data is copied into new memory which replaces the
+ *                segment atomically, so segments other than the current
+ *                one can be loaded while the sequence runs.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                segP		segment header, followed by the frames
+ *                size		block size [bytes]
+ *  Output.....:  return	success (0) or error code
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 SeqLoad(
+	LL_HANDLE *llHdl,
+	M37_SEQ_SEG *segP,
+	int32 size
+)
+{
+	SEQ_SEG	*dstP, old;
+	u_int16	*data = NULL;
+	u_int32	alloc = 0, bytes;
+	OSS_IRQ_STATE irqState;
+
+	if (size < (int32)sizeof(M37_SEQ_SEG))
+		return(ERR_LL_USERBUF);
+	if ( (segP->seg >= SEQ_SEGS) || (segP->frames > SEQ_FRAMES) ||
+		 (segP->next < M37_SEQ_NONE) || (segP->next >= SEQ_SEGS) ||
+		 (segP->branch < M37_SEQ_NONE) || (segP->branch >= SEQ_SEGS) )
+		return(ERR_LL_ILL_PARAM);
+
+	bytes = segP->frames * CH_BYTES * CH_NUMBER;
+	if ((u_int32)size != sizeof(M37_SEQ_SEG) + bytes)
+		return(ERR_LL_USERBUF);
+
+	if (bytes) {
+		if ((data = (u_int16*)OSS_MemGet(llHdl->osHdl, bytes, &alloc)) == NULL)
+			return(ERR_OSS_MEM_ALLOC);
+		OSS_MemCopy(llHdl->osHdl, bytes, (char*)(segP + 1), (char*)data);
+	}
+
+	/* replace (locked against ISR), not the segment being output */
+	dstP = &llHdl->seq[segP->seg];
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	if ((int32)segP->seg == llHdl->seqCur) {
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+		if (data)
+			OSS_MemFree(llHdl->osHdl, (int8*)data, alloc);
+		return(ERR_LL_DEV_BUSY);
+	}
+	old = *dstP;
+	dstP->data   = data;
+	dstP->alloc  = alloc;
+	dstP->frames = segP->frames;
+	dstP->repeat = segP->repeat;
+	dstP->next   = segP->next;
+	dstP->branch = segP->branch;
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	if (old.data)
+		OSS_MemFree(llHdl->osHdl, (int8*)old.data, old.alloc);
+	return(ERR_SUCCESS);
+}
+
+/******************************** OwnSet ************************************
+ *
+ *  Description:  Claim or release channels for an owner (M37_CH_OWN)
+ *
+ *                The owner is identified by the current channel of its
+ *                path, which must be one of the claimed channels. The
+ *                value slots of newly claimed channels start with the
+ *                current output values.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                ch		owner (current channel)
+ *                mask		channels to own (0=release)
+ *  Output.....:  return	success (0) or error code
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 OwnSet(
+	LL_HANDLE *llHdl,
+	int32 ch,
+	u_int32 mask
+)
+{
+	u_int32	n, others = 0;
+	OSS_IRQ_STATE irqState;
+
+	if ( (mask & ~((1<<CH_NUMBER) - 1)) || (mask && !(mask & (1<<ch))) )
+		return(ERR_LL_ILL_PARAM);
+
+	for (n=0; n<CH_NUMBER; n++)
+		if (n != (u_int32)ch)
+			others |= llHdl->own[n];
+	if (mask & others)
+		return(ERR_LL_DEV_BUSY);				/* owned by other path */
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	for (n=0; n<CH_NUMBER; n++)
+		if ((mask & ~llHdl->own[ch]) & (1<<n))
+			llHdl->slotVal[n] = llHdl->chanVal[n];
+	llHdl->own[ch] = (u_int16)mask;
+	llHdl->ownAll  = others | mask;
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	return(ERR_SUCCESS);
+}
+
+/******************************** OwnWrite **********************************
+ *
+ *  Description:  Write the values of an owner's channels (M37_BlockWrite)
+ *
+ *                The values (one word per owned channel, ascending) replace
+ *                the value slots. With the interrupt flag enabled, the ISR
+ *                merges them into the next frame. Otherwise the merged
+ *                frame is committed at once, which is refused with the
+ *                external trigger enabled (nothing would commit the slots).
+ *                The call never waits.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                ch		owner (current channel)
+ *                bufP		values
+ *                size		data size [bytes]
+ *  Output.....:  nbrWrBytesP	number of written bytes
+ *                return	success (0) or error code
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 OwnWrite(
+	LL_HANDLE *llHdl,
+	int32 ch,
+	u_int16 *bufP,
+	int32 size,
+	int32 *nbrWrBytesP
+)
+{
+	u_int32	n, nbr = 0;
+	OSS_IRQ_STATE irqState;
+
+	for (n=0; n<CH_NUMBER; n++)
+		if (llHdl->own[ch] & (1<<n))
+			nbr++;
+	if (size != (int32)(nbr * CH_BYTES))
+		return(ERR_LL_USERBUF);
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	if (!llHdl->irqEn && llHdl->extTrig) {
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+		return(ERR_LL_ILL_PARAM);			/* no commit possible */
+	}
+
+	for (n=0; n<CH_NUMBER; n++)
+		if (llHdl->own[ch] & (1<<n))
+			llHdl->slotVal[n] = *bufP++;
+
+	if (llHdl->irqEn)
+		ConfWrite(llHdl, IRQE, 0);		/* ISR merges and commits */
+	else {
+		OwnMerge(llHdl);
+		CommitFrame(llHdl);
+		llHdl->hwFull = 2;				/* buffer half not verified */
+	}
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	*nbrWrBytesP = size;
+	return(ERR_SUCCESS);
+}
+
+/******************************** OwnMerge **********************************
+ *
+ *  Description:  Merge the value slots of all owned channels into the
+ *                channel store
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  -
+ *  Globals....:  ---
+ ****************************************************************************/
+static void OwnMerge(
+	LL_HANDLE *llHdl
+)
+{
+	u_int32	n;
+
+	for (n=0; n<CH_NUMBER; n++)
+		if (llHdl->ownAll & (1<<n))
+			llHdl->chanVal[n] = llHdl->slotVal[n];
+}
+
+/******************************** StatsGet **********************************
+ *
+ *  Description:  Take a snapshot of the driver statistics
+ *
+ *                All fields are captured with the interrupt masked once.
+ *                The counters and maxima are returned since the last
+ *                reset; with 'reset' they are reset after the snapshot.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                reset		reset counters and maxima
+ *  Output.....:  st		statistics
+ *  Globals....:  ---
+ ****************************************************************************/
+static void StatsGet(
+	LL_HANDLE *llHdl,
+	M37_STATS *st,
+	u_int32 reset
+)
+{
+	STATS_CNT		cnt, base;
+	OSS_IRQ_STATE	irqState;
+	int32			val;
+	u_int32			rate = OSS_TickRateGet(llHdl->osHdl);
+
+	OSS_MemFill(llHdl->osHdl, sizeof(*st), (char*)st, 0);
+	st->version  = M37_STATS_VERSION;
+	st->size     = sizeof(*st);
+	st->tickRate = rate;
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	st->tick = OSS_TickGet(llHdl->osHdl);
+
+	/* counters */
+	cnt.irqs      = llHdl->irqCount;
+	cnt.commits   = llHdl->histSeq;
+	cnt.underruns = llHdl->underruns;
+	cnt.pwrFails  = llHdl->pwrFails;
+	cnt.switches  = llHdl->batchSwitches;
+	cnt.saved     = llHdl->batchSaved;
+	cnt.recovers  = llHdl->pwrRcvs;
+	cnt.bytesIn   = llHdl->bufIn;
+	cnt.bytesOut  = llHdl->bufOut;
+	base = llHdl->stBase;
+	st->fillMax = llHdl->fillMax;
+	st->waitMax = llHdl->waitMax;
+	st->pwrRcvMax = llHdl->pwrRcvMax;
+	st->lateMax = llHdl->lateMax;
+
+	/* state */
+	MBUF_GetBufferMode(llHdl->bufHdl, &val);
+	st->bufMode = val;
+	if (llHdl->ringOn)
+		val = (int32)llHdl->ringSize;
+	else
+		MBUF_GetStat(NULL, llHdl->bufHdl, M_BUF_WR_BUFSIZE, &val);
+	st->bufSize    = val;
+	if ((int32)(cnt.bytesIn - cnt.bytesOut) > 0)	/* no wrap on discard */
+		st->bufFill = cnt.bytesIn - cnt.bytesOut;
+	st->pwr        = (llHdl->statSnap & PWR) ? 1 : 0;
+	st->pwrFail    = llHdl->pwrFail;
+	st->extTrig    = llHdl->extTrig;
+	st->irqEn      = llHdl->irqEn;
+	st->drvRing    = llHdl->ringOn;
+	st->fmt        = llHdl->fmt;
+	st->upFactor   = llHdl->upFactor;
+	st->schedClk   = llHdl->schedClk;
+	st->schedCount = llHdl->schedIn - llHdl->schedOut;
+	st->seqCur     = llHdl->seqCur;
+	st->batchOn    = llHdl->batchOn;
+	st->irqRate    = llHdl->irqRate;
+
+	if (reset) {
+		llHdl->stBase  = cnt;
+		llHdl->fillMax = st->bufFill;
+		llHdl->waitMax = 0;
+		llHdl->pwrRcvMax = 0;
+	}
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	st->irqs          = cnt.irqs      - base.irqs;
+	st->commits       = cnt.commits   - base.commits;
+	st->underruns     = cnt.underruns - base.underruns;
+	st->pwrFails      = cnt.pwrFails  - base.pwrFails;
+	st->batchSwitches = cnt.switches  - base.switches;
+	st->batchSaved    = cnt.saved     - base.saved;
+	st->bytesIn       = cnt.bytesIn   - base.bytesIn;
+	st->bytesOut      = cnt.bytesOut  - base.bytesOut;
+	st->pwrRecovers   = cnt.recovers  - base.recovers;
+	st->waitMax       = st->waitMax * 1000 / rate;		/* msec */
+	st->pwrRcvMax     = st->pwrRcvMax * 1000 / rate;
+}
+
+/******************************** FillUpdate ********************************
+ *
+ *  Description:  Account bytes written to the output buffer
+ *
+ *                Updates the fill level maximum and the maximum time
+ *                the writer waited for buffer space.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                bytes		written bytes
+ *                start		tick at start of the write
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void FillUpdate(
+	LL_HANDLE *llHdl,
+	u_int32 bytes,
+	u_int32 start
+)
+{
+	u_int32 fill, wait = OSS_TickGet(llHdl->osHdl) - start;
+
+	llHdl->bufIn += bytes;
+	fill = llHdl->bufIn - llHdl->bufOut;
+	if ((int32)fill < 0)
+		fill = 0;
+	if (fill > llHdl->fillMax)
+		llHdl->fillMax = fill;
+	if (wait > llHdl->waitMax)
+		llHdl->waitMax = wait;
+}
+
+/******************************** PosGet ************************************
+ *
+ *  Description:  Get the output position of the buffered output
+ *
+ *                The queued bytes include prefetched units and the bytes
+ *                of a partially decoded frame. The driver ring fill is
+ *                taken from its indices; the MBUF fill is known after
+ *                M37_BlockWrite has returned only (else fillValid=0) and
+ *                is 0 while the output is ahead of the accounting.
+ *                The caller must lock against the ISR.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  pos		position
+ *  Globals....:  ---
+ ****************************************************************************/
+static void PosGet(
+	LL_HANDLE *llHdl,
+	M37_POSITION *pos
+)
+{
+	u_int32	bytes;
+
+	pos->tick     = OSS_TickGet(llHdl->osHdl);
+	pos->frames   = llHdl->posFrames;
+	pos->seq      = llHdl->posSeq;
+	pos->commits  = llHdl->histSeq;
+	pos->upFactor = llHdl->upFactor;
+	pos->upPhase  = llHdl->upPhase;
+
+	pos->fillValid = llHdl->ringOn || !llHdl->irqOn;
+	if (llHdl->ringOn)
+		bytes = llHdl->ringIdx.head - llHdl->ringIdx.tail +
+			(llHdl->pfLen - llHdl->pfPos) * CH_BYTES*CH_NUMBER;
+	else if (llHdl->irqOn)					/* MBUF write in progress */
+		bytes = (llHdl->pfLen - llHdl->pfPos) * CH_BYTES*CH_NUMBER;
+	else if ((int32)(llHdl->bufIn - llHdl->bufOut) > 0)
+		bytes = llHdl->bufIn - llHdl->bufOut;	/* incl. prefetched units */
+	else
+		bytes = 0;
+
+	if (llHdl->fmt == M37_FMT_RAW)
+		pos->queued = bytes / (CH_BYTES*CH_NUMBER);
+	else {
+		bytes += llHdl->unitLen - llHdl->unitPos + llHdl->decLen;
+		pos->queued = 0;
+	}
+	pos->queuedBytes = bytes;
+}
+
+/******************************** LowTrack **********************************
+ *
+ *  Description:  Track the output buffer fill for the adaptive lowwater
+ *                level
+ *
+ *                Called by the ISR. Notes when the fill (including
+ *                prefetched units) drops to the lowwater level and the
+ *                lowest fill until the refill. While M37_BlockWrite writes to
+ *                MBUF, the fill is not known and not tracked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void LowTrack(
+	LL_HANDLE *llHdl
+)
+{
+	u_int32 fill, level;
+
+	if (llHdl->ringOn) {
+		fill  = llHdl->ringIdx.head - llHdl->ringIdx.tail +
+			(llHdl->pfLen - llHdl->pfPos) * CH_BYTES*CH_NUMBER;
+		level = llHdl->ringLow;
+	}
+	else {
+		if (llHdl->irqOn)					/* MBUF write in progress */
+			return;
+		fill  = llHdl->bufIn - llHdl->bufOut;	/* incl. prefetched units */
+		level = llHdl->bufLow;
+		if ((int32)fill < 0)
+			fill = 0;
+	}
+
+	if (!llHdl->lowEvent) {
+		if (fill > level)
+			return;
+		llHdl->lowEvent = TRUE;
+		llHdl->lowTick  = OSS_TickGet(llHdl->osHdl);
+		llHdl->lowFill  = ~0;
+	}
+	if (fill < llHdl->lowFill)
+		llHdl->lowFill = fill;
+}
+
+/******************************** LowAdapt **********************************
+ *
+ *  Description:  Adjust the lowwater level at the refill after a lowwater
+ *                event
+ *
+ *                Raises the level by the shortfall of the lowest fill
+ *                against the margin (at least doubles it after an
+ *                underrun) or lowers it by 1/8 of the excess (at least
+ *                one unit), within 8..M37_LOW_MAX.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void LowAdapt(
+	LL_HANDLE *llHdl
+)
+{
+	OSS_IRQ_STATE	irqState;
+	u_int32			fill, level, dec, max, unit = CH_BYTES*CH_NUMBER;
+	int32			size;
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	fill  = llHdl->lowFill;
+	level = llHdl->ringOn ? llHdl->ringLow : llHdl->bufLow;
+	llHdl->lowReact = OSS_TickGet(llHdl->osHdl) - llHdl->lowTick;
+	llHdl->lowEvent = FALSE;
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	if (fill == 0)							/* underrun */
+		level = (level + llHdl->lowMargin > 2 * level) ?
+			level + llHdl->lowMargin : 2 * level;
+	else if (fill < llHdl->lowMargin)
+		level += llHdl->lowMargin - fill;
+	else {
+		dec = ((fill - llHdl->lowMargin) / 8 + unit - 1) / unit * unit;
+		level = dec < level ? level - dec : 0;
+	}
+
+	if (llHdl->ringOn)
+		size = (int32)llHdl->ringSize;
+	else
+		MBUF_GetStat(NULL, llHdl->bufHdl, M_BUF_WR_BUFSIZE, &size);
+	max = llHdl->lowMax ? llHdl->lowMax : (u_int32)size / 2 / unit * unit;
+	level = (level + unit - 1) / unit * unit;
+	if (level > max)
+		level = max;
+	if (level < unit)
+		level = unit;
+
+	if (llHdl->ringOn)
+		llHdl->ringLow = level;
+	else if (level != llHdl->bufLow &&
+			 MBUF_SetStat(NULL, llHdl->bufHdl, M_BUF_WR_LOWWATER, level) == 0)
+		llHdl->bufLow = level;
+}
+
+/******************************** StreamFmtSet ******************************
+ *
+ *  Description:  Set the format of the output buffer data
+ *
+ *                Discards a partially decoded frame. Deltas are applied
+ *                to the current output values. The decimation pattern
+ *                restarts with all channels due.
+ *                The caller must lock against the ISR.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                fmt		data format (M37_FMT_xxx)
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void StreamFmtSet(
+	LL_HANDLE *llHdl,
+	u_int32 fmt
+)
+{
+	u_int32 ch;
+
+	PfDiscard(llHdl);					/* units of the old format */
+	llHdl->fmt     = fmt;
+	llHdl->unitPos = 0;
+	llHdl->unitLen = 0;
+	llHdl->decLen  = 0;
+	for (ch=0; ch<CH_NUMBER; ch++)
+		llHdl->decVal[ch] = llHdl->chanVal[ch];
+	DecimStep(llHdl, TRUE);
+}
+
+/******************************** DecimStep *********************************
+ *
+ *  Description:  Advance the decimation pattern of M37_FMT_DECIM
+ *
+ *                Counts down the frames until each channel is due again
+ *                and computes the channels due in the next frame and
+ *                their number of bytes.
+ *                The caller must lock against the ISR.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                restart	TRUE: all channels due (start of pattern)
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void DecimStep(
+	LL_HANDLE *llHdl,
+	u_int32 restart
+)
+{
+	u_int32 ch;
+
+	for (ch=0; ch<CH_NUMBER; ch++) {
+		if (restart)
+			llHdl->decCnt[ch] = 0;
+		else if (llHdl->decDue & (1<<ch))
+			llHdl->decCnt[ch] = llHdl->decim[ch] - 1;
+		else
+			llHdl->decCnt[ch]--;
+	}
+
+	llHdl->decDue  = 0;
+	llHdl->decNeed = 0;
+	for (ch=0; ch<CH_NUMBER; ch++)
+		if (llHdl->decCnt[ch] == 0) {
+			llHdl->decDue  |= 1<<ch;
+			llHdl->decNeed += CH_BYTES;
+		}
+}
+
+/******************************** UpsampleSet *******************************
+ *
+ *  Description:  Set upsampling factor and interpolation
+ *
+ *                Computes the FIR coefficients of the Catmull-Rom spline
+ *                for each phase t=p/factor in fixed point:
+ *                  c0 = (-t^3 + 2t^2 - t) / 2
+ *                  c1 = (3t^3 - 5t^2 + 2) / 2
+ *                  c2 = (-3t^3 + 4t^2 + t) / 2
+ *                  c3 = (t^3 - t^2) / 2
+ *                and restarts the interpolation.
+ *                The caller must lock against the ISR.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *                factor	upsampling factor (1..M37_UPS_MAX)
+ *                mode		interpolation (M37_UPS_xxx)
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void UpsampleSet(
+	LL_HANDLE *llHdl,
+	u_int32 factor,
+	u_int32 mode
+)
+{
+	int32	p, n = (int32)factor, t1, t2, t3, t0, div, *c;
+
+	/* terms scaled by n^3: t^3 = p^3, t^2 = p^2*n, t = p*n^2, 1 = n^3 */
+	t0  = n * n * n;
+	div = 2 * t0;
+	for (p=0; p<n; p++) {
+		c  = llHdl->upCoef[p];
+		t3 = p * p * p;
+		t2 = p * p * n;
+		t1 = p * n * n;
+		c[0] = (-t3 + 2*t2 - t1) * (1<<UPS_FRAC) / div;
+		c[2] = (-3*t3 + 4*t2 + t1) * (1<<UPS_FRAC) / div;
+		c[3] = (t3 - t2) * (1<<UPS_FRAC) / div;
+		c[1] = (1<<UPS_FRAC) - c[0] - c[2] - c[3];	/* unity DC gain */
+	}
+
+	llHdl->upFactor = factor;
+	llHdl->upMode   = mode;
+	llHdl->upPhase  = 0;
+	llHdl->upTail   = 0;
+	llHdl->upIdle   = TRUE;
+}
+
+/******************************** ClockBusy *********************************
+ *
+ *  Description:  Check if setpoints or ramps wait for the schedule clock
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  return	TRUE if busy
+ *  Globals....:  ---
+ ****************************************************************************/
+static int32 ClockBusy(
+	LL_HANDLE *llHdl
+)
+{
+	return( llHdl->schedIn != llHdl->schedOut || llHdl->rampMask );
+}
+
+/******************************** ClockStart ********************************
+ *
+ *  Description:  Start the schedule clock if setpoints or ramps wait for it
+ *
+ *                The timer clock starts the schedule timer, the trigger
+ *                clock enables the interrupt on the hardware.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void ClockStart(
+	LL_HANDLE *llHdl
+)
+{
+	u_int32 realMsec;
+
+	if (!ClockBusy(llHdl))
+		return;
+
+	if (llHdl->schedClk == M37_SCHED_CLK_TRIG)
+		ConfWriteLocked(llHdl, IRQE, 0);
+	else if (!llHdl->alarmOn)  {
+		llHdl->alarmOn = TRUE;
+		OSS_AlarmSet(llHdl->osHdl, llHdl->alarmHdl, SCHED_TIMER_MS, TRUE,
+					 &realMsec);
+	}
+}
+
+/******************************** AlarmHandler ******************************
+ *
+ *  Description:  Schedule timer routine
+ *
+ *                Applies the due setpoints, advances the ramps and commits
+ *                them with one update strobe. When the hardware buffer is
+ *                not ready, this is done at the next timer tick. The timer
+ *                stops when no setpoints are queued and no ramp is active.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  arg		low-level handle
+ *  Output.....:  ---
+ *  Globals....:  ---
+ ****************************************************************************/
+static void AlarmHandler(
+	void *arg
+)
+{
+	LL_HANDLE		*llHdl = (LL_HANDLE*)arg;
+	OSS_IRQ_STATE	irqState;
+	u_int32			path;
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	path = llHdl->busPath;				/* interrupted path */
+	llHdl->busPath = M37_BUS_TIMER;
+
+	if (llHdl->pwrWatch)
+		PwrWatch(llHdl);				/* power failure recovery first */
+	else if (llHdl->schedClk == M37_SCHED_CLK_TIMER &&
+		(StatRead(llHdl) & BUFRDY))  {
+		if (SchedApply(llHdl, OSS_TickGet(llHdl->osHdl)) |
+			RampAdvance(llHdl))
+			CommitFrame(llHdl);
+	}
+
+	if (!llHdl->pwrWatch &&
+		(llHdl->schedClk != M37_SCHED_CLK_TIMER || !ClockBusy(llHdl)))  {
+		OSS_AlarmClear(llHdl->osHdl, llHdl->alarmHdl);
+		llHdl->alarmOn = FALSE;
+	}
+
+	llHdl->busPath = path;
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+}
@@ -0,0 +1,302 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                   M37FRAME_BENCH                   ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ls
+ *
+ *  Description: Benchmark and allocation check of the m37frame builder
+ *
+ *               Builds blocks for buffered output with
+ *               - an allocated buffer per block and manual interleaving
+ *                 (as m37_blkwrite does)
+ *               - m37::StaticBatch for several channel masks and sample
+ *                 types
+ *               and reports frames per second and heap allocations per
+ *               block. The program fails (exit code 1) if the frame
+ *               builder allocates in the steady state.
+ *               With a device, every block is also written with
+ *               M_setblock.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *               C++17 (e.g. g++ -std=c++17 -O2)
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2010-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+extern "C" {
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+}
+#include <MEN/m37_drv.h>
+#include <MEN/m37frame.h>
+
+#ifndef MAK_REVISION
+#	define MAK_REVISION unknown
+#endif
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define CH_NUMBER			4			/* nr of device channels */
+#define BLK_FRAMES			256			/* frames per block */
+
+using Clock = std::chrono::steady_clock;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static unsigned long	G_allocs;		/* heap allocations (operator new) */
+static float			G_volt[BLK_FRAMES * CH_NUMBER];	/* input samples */
+static u_int16			G_code[BLK_FRAMES * CH_NUMBER];
+static volatile u_int16	G_sink;			/* keeps the result alive */
+static int32			G_outErr;		/* M_setblock failed */
+
+/* count heap allocations */
+void *operator new(size_t size)
+{
+	G_allocs++;
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void Report(const char *name, Clock::time_point t0,
+				   unsigned long allocs, int blocks);
+static int32 Output(MDIS_PATH path, const void *buf, int32 size);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m37frame_bench [<opts>] [<device>] [<opts>]\n"          );
+	printf("Function: Benchmark and allocation check of m37frame\n"			);
+	printf("Options:\n"														);
+	printf("    device       device name (write blocks) ........... [none]\n");
+	printf("    -n=<num>     number of blocks (256 frames) ........ [10000]\n");
+	printf("\n");
+	printf("Copyright 2010-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_allocs
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH	path = -1;
+	int			blocks, b, f, ch, n, ret = 0;
+	unsigned long allocs;
+	char		*device,*str,*errstr, buf[40];
+	Clock::time_point t0;
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT((char*)"n=?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT((char*)"?")) {				/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	blocks = ((str = UTL_TSTOPT((char*)"n=")) ? atoi(str) : 10000);
+	if (blocks < 1) {
+		usage();
+		return(1);
+	}
+
+	/* sawtooth input */
+	for (n=0; n<BLK_FRAMES * CH_NUMBER; n++) {
+		G_volt[n] = -10.0f + 20.0f * (n / CH_NUMBER) / BLK_FRAMES;
+		G_code[n] = m37::voltToCode(G_volt[n]);
+	}
+
+	/*--------------------+
+    |  open, config       |
+    +--------------------*/
+	if (device) {
+		if ((path = M_open(device)) < 0) {
+			printf("*** can't open: %s\n", M_errstring(UOS_ErrnoGet()));
+			return(1);
+		}
+		if (M_setstat(path, M_BUF_WR_MODE, M_BUF_RINGBUF) < 0 ||
+			M_setstat(path, M37_EXT_TRIG, 1) < 0 ||
+			M_setstat(path, M_MK_IRQ_ENABLE, 1) < 0) {
+			printf("*** can't setstat: %s\n", M_errstring(UOS_ErrnoGet()));
+			M_close(path);
+			return(1);
+		}
+	}
+
+	printf("builder               frames/s   allocs/block\n");
+
+	/*--------------------+
+    |  allocated buffer   |
+    +--------------------*/
+	allocs = G_allocs;
+	t0 = Clock::now();
+	for (b=0; b<blocks; b++) {
+		u_int16 *blkbuf = new u_int16[BLK_FRAMES * CH_NUMBER];
+		for (f=0; f<BLK_FRAMES; f++)
+			for (ch=0; ch<CH_NUMBER; ch++) {
+				double calc = G_volt[f*CH_NUMBER + ch] * (0xffff/20.0);
+				blkbuf[f*CH_NUMBER + ch] =
+					(u_int16)(int16)(calc >= 0 ? calc + 0.5 : calc - 0.5);
+			}
+		G_sink = blkbuf[b % (BLK_FRAMES * CH_NUMBER)];
+		if (Output(path, blkbuf, BLK_FRAMES * CH_NUMBER * 2))
+			ret = 1;
+		delete[] blkbuf;
+	}
+	Report("new + interleave", t0, G_allocs - allocs, blocks);
+
+	/*--------------------+
+    |  frame builder      |
+    +--------------------*/
+	{
+		static m37::StaticBatch<0xf, BLK_FRAMES>				bCode;
+		static m37::StaticBatch<0xf, BLK_FRAMES, m37::Volt>	bVolt;
+		static m37::StaticBatch<0x3, BLK_FRAMES>				bPair;
+		static m37::StaticBatch<0x5, BLK_FRAMES, m37::Volt>	bOdd;
+		unsigned long total = 0;
+
+		bPair.hold(2, m37::voltToCode(0.0));
+		bPair.hold(3, m37::voltToCode(0.0));
+		bOdd.hold(1, m37::voltToCode(0.0));
+		bOdd.hold(3, m37::voltToCode(0.0));
+
+#define BENCH(name, batch, src) \
+		allocs = G_allocs; \
+		t0 = Clock::now(); \
+		for (b=0; b<blocks; b++) { \
+			batch.clear(); \
+			batch.pack(src, BLK_FRAMES); \
+			G_sink = ((const u_int16*)batch.data())[b % BLK_FRAMES]; \
+			if (Output(path, batch.data(), batch.bytes())) \
+				ret = 1; \
+		} \
+		total += G_allocs - allocs; \
+		Report(name, t0, G_allocs - allocs, blocks)
+
+		BENCH("batch 0xf code", bCode, G_code);
+		BENCH("batch 0xf volt", bVolt, G_volt);
+		BENCH("batch 0x3 code", bPair, G_code);
+		BENCH("batch 0x5 volt", bOdd, G_volt);
+#undef BENCH
+
+		if (total) {
+			printf("*** frame builder allocated %lu times\n", total);
+			ret = 1;
+		}
+	}
+
+	if (path >= 0) {
+		M_setstat(path, M_MK_IRQ_ENABLE, 0);
+		M_close(path);
+	}
+	return(ret);
+}
+
+/********************************* Report ***********************************
+ *
+ *  Description: Print frame rate and allocations of one builder
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: name		builder
+ *               t0			start time
+ *               allocs		allocations
+ *               blocks		number of blocks
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void Report(
+	const char *name,
+	Clock::time_point t0,
+	unsigned long allocs,
+	int blocks
+)
+{
+	double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+	printf("%-18s %12.0f %14.2f\n", name,
+		   (double)blocks * BLK_FRAMES / sec, (double)allocs / blocks);
+}
+
+/********************************* Output ***********************************
+ *
+ *  Description: Write block to the device (if opened)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: path		path number or -1
+ *               buf		block
+ *               size		block size [bytes]
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_outErr
+ ****************************************************************************/
+static int32 Output(
+	MDIS_PATH path,
+	const void *buf,
+	int32 size
+)
+{
+	if (path < 0 || G_outErr)
+		return(G_outErr);
+	if (M_setblock(path, (u_int8*)buf, size) < 0) {
+		printf("*** can't setblock: %s\n", M_errstring(UOS_ErrnoGet()));
+		G_outErr = 1;
+	}
+	return(G_outErr);
+}
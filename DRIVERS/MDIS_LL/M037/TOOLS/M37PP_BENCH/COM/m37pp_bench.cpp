@@ -0,0 +1,258 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M37PP_BENCH                     ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ls
+ *
+ *  Description: Compare the submission latency of M_setblock and the
+ *               m37pp AsyncWriter
+ *
+ *               Several producer threads write blocks for buffered output,
+ *               either with M_setblock directly or through one
+ *               m37::AsyncWriter. For each block the time the producer
+ *               spends in the call is measured.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *               C++17 (e.g. g++ -std=c++17 -pthread)
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2010-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <MEN/m37pp.h>
+extern "C" {
+#include <MEN/usr_utl.h>
+}
+
+#ifndef MAK_REVISION
+#	define MAK_REVISION unknown
+#endif
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define CH_NUMBER			4			/* nr of device channels */
+
+using Clock = std::chrono::steady_clock;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void Bench(m37::Device &dev, int async, int threads, int blocks,
+				  int frames);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m37pp_bench [<opts>] <device> [<opts>]\n"               );
+	printf("Function: Compare submission latency of M_setblock and m37pp\n");
+	printf("Options:\n"														);
+	printf("    device       device name .......................... [none]\n");
+	printf("    -m=<mode>    interface to measure ................. [2]\n"	);
+	printf("                  0 = M_setblock\n");
+	printf("                  1 = m37::AsyncWriter\n");
+	printf("                  2 = both\n");
+	printf("    -t=<num>     producer threads ..................... [4]\n"	);
+	printf("    -n=<num>     blocks per producer .................. [1000]\n");
+	printf("    -k=<frames>  frames per block ..................... [16]\n"	);
+	printf("\n");
+	printf("The output is triggered externally (M37_EXT_TRIG).\n");
+	printf("\n");
+	printf("Copyright 2010-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	int		mode, threads, blocks, frames, n;
+	char	*device,*str,*errstr, buf[40];
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT((char*)"m=t=n=k=?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT((char*)"?")) {				/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	if (!device) {
+		usage();
+		return(1);
+	}
+
+	mode    = ((str = UTL_TSTOPT((char*)"m=")) ? atoi(str) : 2);
+	threads = ((str = UTL_TSTOPT((char*)"t=")) ? atoi(str) : 4);
+	blocks  = ((str = UTL_TSTOPT((char*)"n=")) ? atoi(str) : 1000);
+	frames  = ((str = UTL_TSTOPT((char*)"k=")) ? atoi(str) : 16);
+
+	if (mode < 0 || mode > 2 || threads < 1 || blocks < 1 || frames < 1) {
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  open, config       |
+    +--------------------*/
+	try {
+		m37::Device dev(device);
+
+		dev.setStat(M_BUF_WR_MODE, M_BUF_RINGBUF);
+		dev.setStat(M37_EXT_TRIG, 1);
+		dev.setStat(M_MK_IRQ_ENABLE, 1);
+
+		printf("interface       blocks/s   avg[us]   p99[us]   max[us]\n");
+		if (mode != 1)
+			Bench(dev, 0, threads, blocks, frames);
+		if (mode != 0)
+			Bench(dev, 1, threads, blocks, frames);
+
+		dev.setStat(M_MK_IRQ_ENABLE, 0);
+	}
+	catch (const std::exception &e) {
+		printf("*** %s\n", e.what());
+		return(1);
+	}
+	return(0);
+}
+
+/********************************* Bench ************************************
+ *
+ *  Description: Write blocks from several threads and print the latency
+ *               of the write calls
+ *
+ *               With the AsyncWriter the time includes the submission only
+ *               (including the wait while its queue is full); the rate is
+ *               measured until all blocks have completed.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: dev		device
+ *               async		use AsyncWriter (1) or M_setblock (0)
+ *               threads	number of producer threads
+ *               blocks		blocks per producer
+ *               frames		frames per block
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void Bench(
+	m37::Device &dev,
+	int async,
+	int threads,
+	int blocks,
+	int frames
+)
+{
+	std::vector<u_int16>	data(frames * CH_NUMBER);
+	std::vector<double>		lat;				/* call latencies [us] */
+	std::vector<std::thread> prod;
+	std::mutex				latMtx;
+	int						n;
+
+	/* sawtooth over full range */
+	for (n=0; n<frames * CH_NUMBER; n++)
+		data[n] = (u_int16)((n / CH_NUMBER) * (0x10000 / frames));
+
+	std::unique_ptr<m37::AsyncWriter> writer;
+	if (async)
+		writer = std::make_unique<m37::AsyncWriter>(dev);
+	Clock::time_point t0 = Clock::now();
+
+	for (n=0; n<threads; n++)
+		prod.emplace_back([&] {
+			std::vector<double> my;
+			my.reserve(blocks);
+			try {
+				for (int b=0; b<blocks; b++) {
+					Clock::time_point c0 = Clock::now();
+					if (writer)
+						writer->submit(data, nullptr);
+					else
+						dev.writeBlock(data.data(), (int32_t)data.size() * 2);
+					my.push_back(std::chrono::duration<double, std::micro>(
+									 Clock::now() - c0).count());
+				}
+			}
+			catch (const std::exception &e) {
+				printf("*** %s\n", e.what());
+			}
+			std::lock_guard<std::mutex> lk(latMtx);
+			lat.insert(lat.end(), my.begin(), my.end());
+		});
+	for (auto &t : prod)
+		t.join();
+
+	if (writer)
+		writer->flush();
+	double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+	if (lat.empty())
+		return;
+	std::sort(lat.begin(), lat.end());
+	double sum = 0;
+	for (double l : lat)
+		sum += l;
+
+	printf("%-13s %10.0f %9.1f %9.1f %9.1f\n",
+		   async ? "m37pp async" : "M_setblock",
+		   lat.size() / sec, sum / lat.size(),
+		   lat[lat.size() * 99 / 100], lat.back());
+	if (writer)
+		printf("  (%u M_setblock calls)\n", writer->batches());
+}
@@ -0,0 +1,206 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M37_INVENTORY                   ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ls
+ *
+ *  Description: List the identification of all M37 modules
+ *
+ *               For each device, the module ID, revision, serial number,
+ *               ID PROM checksum and PLD ident are read with one
+ *               M37_BLK_ID_INFO call. The driver serves them from the ID
+ *               PROM image cached at init, the PROM is not accessed.
+ *               The devices are given by name or scanned by prefix
+ *               (<prefix>1..<prefix>n, missing devices are skipped).
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2010-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/m37_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define ID_MAGIC			0x5346		/* ID PROM magic word */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static int32 Inventory(char *device, int32 quiet);
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static u_int32	G_nMod;				/* modules listed */
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m37_inventory [<opts>] [<device>..] [<opts>]\n"          );
+	printf("Function: List the identification of all M37 modules\n"		);
+	printf("Options:\n"														);
+	printf("    device       device name(s) ....................... [none]\n");
+	printf("    -s=<prefix>  scan devices <prefix>1..<prefix>n .... [none]\n");
+	printf("    -n=<num>     number of devices to scan ............ [16]\n"	);
+	printf("    -d           dump ID PROM image ................... [no]\n"	);
+	printf("\n");
+	printf("Copyright 2010-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_nMod
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	int32	n, num, dump, ret = 0;
+	u_int32	start, ms;
+	char	*prefix, *errstr, *str, buf[40], device[80];
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("s=n=d?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	prefix = UTL_TSTOPT("s=");
+	num    = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 16);
+	dump   = (UTL_TSTOPT("d") ? 1 : 0);
+
+	for (n=1; n<argc; n++)
+		if (*argv[n] != '-')
+			break;
+
+	if (n == argc && !prefix) {
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  list modules       |
+    +--------------------*/
+	printf("device       id      rev     serial  csum    pld\n");
+	start = UOS_MsecTimerGet();
+
+	for (n=1; n<argc; n++)						/* named devices */
+		if (*argv[n] != '-' && Inventory(argv[n], dump ? 2 : 0))
+			ret = 1;
+
+	if (prefix) {								/* scanned devices */
+		for (n=1; n<=num; n++) {
+			sprintf(device, "%.70s%ld", prefix, n);
+			Inventory(device, dump ? 3 : 1);
+		}
+	}
+
+	ms = UOS_MsecTimerGet() - start;
+	printf("\n%lu modules in %lu msec", G_nMod, ms);
+	if (G_nMod)
+		printf(" (%lu usec per module)", ms * 1000 / G_nMod);
+	printf("\n");
+
+	return(ret);
+}
+
+/********************************* Inventory ********************************
+ *
+ *  Description: Read and print the identification of one module
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: device		device name
+ *               flags		bit 0: missing device is no error (scan)
+ *                          bit 1: dump ID PROM image
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_nMod
+ ****************************************************************************/
+static int32 Inventory(
+	char *device,
+	int32 flags
+)
+{
+	MDIS_PATH	path;
+	M37_ID_INFO	inf;
+	M_SG_BLOCK	blk;
+	int32		n, ret = 0;
+
+	if ((path = M_open(device)) < 0) {
+		if (!(flags & 1))
+			printf("%-12s *** can't open: %s\n", device,
+				   M_errstring(UOS_ErrnoGet()));
+		return(1);
+	}
+
+	blk.size = sizeof(inf);
+	blk.data = (void*)&inf;
+	if ((M_getstat(path, M37_BLK_ID_INFO, (int32*)&blk)) < 0) {
+		printf("%-12s *** can't getstat M37_BLK_ID_INFO: %s\n", device,
+			   M_errstring(UOS_ErrnoGet()));
+		ret = 1;
+	}
+	else {
+		printf("%-12s 0x%04x  0x%04x  %-7u 0x%04x  %s%s\n", device,
+			   inf.modId, inf.revision, inf.serial, inf.csum, inf.pldIdent,
+			   inf.magic != ID_MAGIC ? "  *** illegal magic" : "");
+		if (flags & 2)
+			for (n=0; n<(int32)(sizeof(inf.data)/2); n++)
+				printf("%s%04x%s", n % 8 ? " " : "  ", inf.data[n],
+					   n % 8 == 7 ? "\n" : "");
+		G_nMod++;
+	}
+
+	M_close(path);
+	return(ret);
+}
@@ -0,0 +1,297 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M37_RINGBENCH                   ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ls
+ *
+ *  Description: Compare buffered output via MBUF and driver ring
+ *
+ *               Streams a waveform for a given time with the MBUF
+ *               library and/or the driver ring (M37_DRV_RING) and reports
+ *               the sustained frame rate, interrupt rate and CPU usage
+ *               of the writing process.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2010-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/m37_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define CH_NUMBER			4			/* nr of device channels */
+#define FRAME_SIZE			(CH_NUMBER*2)	/* bytes per frame */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintError(char *info);
+static int32 Bench(MDIS_PATH path, int32 drvRing, int32 sec,
+				   u_int16 *blkbuf, int32 blksize);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m37_ringbench [<opts>] <device> [<opts>]\n"             );
+	printf("Function: Compare M37 buffered output via MBUF and driver ring\n");
+	printf("Options:\n"														);
+	printf("    device       device name .......................... [none]\n");
+	printf("    -m=<mode>    buffer to measure .................... [2]\n"	);
+	printf("                  0 = MBUF library\n");
+	printf("                  1 = driver ring (M37_DRV_RING)\n");
+	printf("                  2 = both\n");
+	printf("    -n=<sec>     measurement time per buffer [sec] .... [10]\n");
+	printf("    -k=<frames>  frames per block write ............... [64]\n");
+	printf("    -o=<msec>    block write timeout [msec] (0=none) .. [Default->Descriptor]\n");
+	printf("\n");
+	printf("The output is triggered externally (M37_EXT_TRIG).\n");
+	printf("\n");
+	printf("Copyright 2010-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH	path=0;
+	int32	mode, sec, frames, blksize, n, ch, ret=1;
+	u_int16	*blkbuf = NULL;
+    char	*device,*str,*errstr, buf[40];
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("m=n=k=o=?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	if (!device) {
+		usage();
+		return(1);
+	}
+
+	mode   = ((str = UTL_TSTOPT("m=")) ? atoi(str) : 2);
+	sec    = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 10);
+	frames = ((str = UTL_TSTOPT("k=")) ? atoi(str) : 64);
+
+	if (mode < 0 || mode > 2 || sec < 1 || frames < 1) {
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+	| create buffer       |
+	+--------------------*/
+	/* sawtooth over full range */
+	blksize = frames * FRAME_SIZE;
+	if ((blkbuf = (u_int16*)malloc(blksize)) == NULL) {
+		printf("*** can't alloc %ld bytes\n",blksize);
+		return(1);
+	}
+	for (n=0; n<frames; n++)
+		for (ch=0; ch<CH_NUMBER; ch++)
+			blkbuf[n*CH_NUMBER + ch] = (u_int16)(n * (0x10000 / frames));
+
+	/*--------------------+
+    |  open path          |
+    +--------------------*/
+	if ((path = M_open(device)) < 0) {
+		PrintError("open");
+		free(blkbuf);
+		return(1);
+	}
+
+	/*--------------------+
+    |  config             |
+    +--------------------*/
+	if ((M_setstat(path, M_BUF_WR_MODE, M_BUF_RINGBUF)) < 0) {
+		PrintError("setstat M_BUF_WR_MODE");
+		goto abort;
+	}
+	if ((str = UTL_TSTOPT("o="))) {
+		if ((M_setstat(path, M_BUF_WR_TIMEOUT, atoi(str))) < 0) {
+			PrintError("setstat M_BUF_WR_TIMEOUT");
+			goto abort;
+		}
+	}
+	if ((M_setstat(path, M37_EXT_TRIG, 1)) < 0) {
+		PrintError("setstat M37_EXT_TRIG");
+		goto abort;
+	}
+
+	/*--------------------+
+    |  measure            |
+    +--------------------*/
+	printf("buffer         frames/s     irq/s   cpu[%%]  us/block\n");
+
+	if (mode != 1 && Bench(path, 0, sec, blkbuf, blksize))
+		goto abort;
+	if (mode != 0 && Bench(path, 1, sec, blkbuf, blksize))
+		goto abort;
+
+	ret = 0;
+
+	/*--------------------+
+    |  cleanup            |
+    +--------------------*/
+	abort:
+	M_setstat(path, M_MK_IRQ_ENABLE, 0);
+	M_setstat(path, M37_DRV_RING, 0);
+
+	if (M_close(path) < 0)
+		PrintError("close");
+
+	free(blkbuf);
+	return(ret);
+}
+
+/********************************* Bench ************************************
+ *
+ *  Description: Stream the block for the given time and print the rates
+ *
+ *               The CPU usage is the process time (clock()) in relation
+ *               to the elapsed time.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: path		path number
+ *               drvRing	use driver ring (1) or MBUF (0)
+ *               sec		measurement time [sec]
+ *               blkbuf		data block
+ *               blksize	data block size [bytes]
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 Bench(
+	MDIS_PATH path,
+	int32 drvRing,
+	int32 sec,
+	u_int16 *blkbuf,
+	int32 blksize
+)
+{
+	int32	irq0, irq1, written, blocks=0;
+	u_int32	start, elapsed;
+	double	bytes=0, cpu;
+	clock_t	clk0;
+
+	if ((M_setstat(path, M_MK_IRQ_ENABLE, 0)) < 0) {
+		PrintError("setstat M_MK_IRQ_ENABLE");
+		return(1);
+	}
+	if ((M_setstat(path, M37_DRV_RING, drvRing)) < 0) {
+		PrintError("setstat M37_DRV_RING");
+		return(1);
+	}
+	if ((M_setstat(path, M_MK_IRQ_ENABLE, 1)) < 0) {
+		PrintError("setstat M_MK_IRQ_ENABLE");
+		return(1);
+	}
+	if ((M_getstat(path, M_LL_IRQ_COUNT, &irq0)) < 0) {
+		PrintError("getstat M_LL_IRQ_COUNT");
+		return(1);
+	}
+
+	clk0  = clock();
+	start = UOS_MsecTimerGet();
+
+	do {
+		if ((written = M_setblock(path, (u_int8*)blkbuf, blksize)) < 0) {
+			PrintError("setblock");
+			return(1);
+		}
+		bytes += written;
+		blocks++;
+	} while ((elapsed = UOS_MsecTimerGet() - start) < (u_int32)sec * 1000);
+
+	cpu = (double)(clock() - clk0) / CLOCKS_PER_SEC;
+
+	if ((M_getstat(path, M_LL_IRQ_COUNT, &irq1)) < 0) {
+		PrintError("getstat M_LL_IRQ_COUNT");
+		return(1);
+	}
+
+	printf("%-12s %10.0f %9.0f %8.1f %9.1f\n",
+		   drvRing ? "driver ring" : "MBUF",
+		   bytes / FRAME_SIZE * 1000.0 / elapsed,
+		   (double)(irq1 - irq0) * 1000.0 / elapsed,
+		   cpu * 100000.0 / elapsed,
+		   cpu * 1e6 / blocks);
+
+	return(0);
+}
+
+/********************************* PrintError ********************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+
+static void PrintError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
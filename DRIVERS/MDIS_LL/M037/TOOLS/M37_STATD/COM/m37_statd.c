@@ -0,0 +1,358 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                     M37_STATD                      ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ls
+ *
+ *  Description: Export the statistics of all M37 devices in Prometheus
+ *               text format
+ *
+ *               The devices are opened once and sampled periodically with
+ *               one M37_BLK_STATS call each (no reset, other readers are
+ *               not disturbed). The metrics are written to a text file,
+ *               which is replaced atomically (written to <file>.tmp and
+ *               renamed), e.g. for the textfile collector of the node
+ *               exporter. Besides the driver counters, the frame rate and
+ *               the underrun rate of the last interval are computed.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2010-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/m37_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define DEV_MAX				32			/* max. number of devices */
+#define CNT_NUM				5			/* exported counters */
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/* sampled device */
+typedef struct {
+	char		*name;				/* device name */
+	MDIS_PATH	path;				/* path (-1 = not open) */
+	int32		up;					/* last sample valid */
+	int32		valid;				/* 'last' valid */
+	M37_STATS	last;				/* last sample */
+	double		total[CNT_NUM];		/* counters since start */
+	double		fps;				/* frames/s of last interval */
+	double		upm;				/* underruns/min of last interval */
+} DEV;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void Sample(DEV *dev);
+static int32 Export(DEV *dev, int32 nDev, char *file);
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+/* exported counters: name, help */
+static const char *G_cnt[CNT_NUM][2] = {
+	{ "m37_irqs_total",				"Interrupts" },
+	{ "m37_frames_total",			"Frames committed to the outputs" },
+	{ "m37_underruns_total",		"Interrupts with empty output buffer" },
+	{ "m37_power_failures_total",	"Power supply failures" },
+	{ "m37_power_recoveries_total",	"Recoveries from power supply failures" },
+};
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m37_statd [<opts>] <device>.. [<opts>]\n"               );
+	printf("Function: Export M37 statistics in Prometheus text format\n"	);
+	printf("Options:\n"														);
+	printf("    device       device name(s) ....................... [none]\n");
+	printf("    -o=<file>    metrics file ......................... [m37.prom]\n");
+	printf("    -t=<msec>    sample interval ...................... [1000]\n");
+	printf("    -n=<num>     number of samples (0 = endless) ...... [0]\n"	);
+	printf("\n");
+	printf("Press any key to stop.\n");
+	printf("\n");
+	printf("Copyright 2010-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	static DEV	dev[DEV_MAX];
+	int32	n, nDev, interval, count, ret = 0;
+	u_int32	next;
+	char	*file, *str, *errstr, buf[40];
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("o=t=n=?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (nDev=0, n=1; n<argc && nDev<DEV_MAX; n++)
+		if (*argv[n] != '-') {
+			dev[nDev].name = argv[n];
+			dev[nDev].path = -1;
+			nDev++;
+		}
+
+	if (!nDev) {
+		usage();
+		return(1);
+	}
+
+	file     = ((str = UTL_TSTOPT("o=")) ? str : "m37.prom");
+	interval = ((str = UTL_TSTOPT("t=")) ? atoi(str) : 1000);
+	count    = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 0);
+
+	if (interval < 1) {
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  sample, export     |
+    +--------------------*/
+	next = UOS_MsecTimerGet();
+	for (n=0; !count || n<count; n++) {
+		for (nDev=0; nDev<DEV_MAX && dev[nDev].name; nDev++)
+			Sample(&dev[nDev]);
+
+		if (Export(dev, nDev, file)) {
+			ret = 1;
+			break;
+		}
+
+		next += interval;						/* no drift */
+		while ((int32)(next - UOS_MsecTimerGet()) > 0)
+			UOS_Delay(next - UOS_MsecTimerGet() < 100 ?
+					  next - UOS_MsecTimerGet() : 100);
+		if (UOS_KeyPressed() != -1)
+			break;
+	}
+
+	/*--------------------+
+    |  cleanup            |
+    +--------------------*/
+	for (n=0; n<DEV_MAX && dev[n].name; n++)
+		if (dev[n].path >= 0)
+			M_close(dev[n].path);
+
+	return(ret);
+}
+
+/********************************* Sample ***********************************
+ *
+ *  Description: Sample the statistics of one device
+ *
+ *               Opens the device if necessary (it is opened again after
+ *               an error). The counter totals are advanced by the
+ *               difference to the last sample; a counter which has been
+ *               reset by another reader (M37_BLK_STATS_CLR) is taken as
+ *               difference.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: dev		device
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void Sample(
+	DEV *dev
+)
+{
+	M37_STATS	st, *l = &dev->last;
+	M_SG_BLOCK	blk;
+	u_int32		cur[CNT_NUM], prev[CNT_NUM], n;
+	double		sec;
+
+	dev->up = FALSE;
+	if (dev->path < 0 && (dev->path = M_open(dev->name)) < 0)
+		return;
+
+	blk.size = sizeof(st);
+	blk.data = (void*)&st;
+	if ((M_getstat(dev->path, M37_BLK_STATS, (int32*)&blk)) < 0 ||
+		st.version < M37_STATS_VERSION) {		/* fields appended only */
+		M_close(dev->path);
+		dev->path  = -1;
+		dev->valid = FALSE;
+		return;
+	}
+	dev->up = TRUE;
+
+	cur[0] = st.irqs;		prev[0] = l->irqs;
+	cur[1] = st.commits;	prev[1] = l->commits;
+	cur[2] = st.underruns;	prev[2] = l->underruns;
+	cur[3] = st.pwrFails;	prev[3] = l->pwrFails;
+	cur[4] = st.pwrRecovers; prev[4] = l->pwrRecovers;
+
+	if (dev->valid) {
+		for (n=0; n<CNT_NUM; n++)
+			dev->total[n] += (cur[n] >= prev[n] ? cur[n] - prev[n] : cur[n]);
+
+		sec = (double)(st.tick - l->tick) / st.tickRate;
+		if (sec > 0) {
+			dev->fps = (cur[1] >= prev[1] ? cur[1] - prev[1] : cur[1]) / sec;
+			dev->upm = (cur[2] >= prev[2] ? cur[2] - prev[2] : cur[2]) /
+				sec * 60;
+		}
+	}
+	*l = st;
+	dev->valid = TRUE;
+}
+
+/********************************* Export ***********************************
+ *
+ *  Description: Write the metrics of all devices to the metrics file
+ *
+ *               The file is written to <file>.tmp and renamed, so that
+ *               readers never see a partial file.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: dev		devices
+ *               nDev		number of devices
+ *               file		metrics file
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 Export(
+	DEV *dev,
+	int32 nDev,
+	char *file
+)
+{
+	char	tmp[256];
+	FILE	*fp;
+	int32	n, d;
+
+#define GAUGE(metric, help) \
+	fprintf(fp, "# HELP %s %s\n# TYPE %s gauge\n", metric, help, metric)
+#define VALUE(metric, i, fmt, val) \
+	fprintf(fp, "%s{device=\"%s\"} " fmt "\n", metric, dev[i].name, val)
+
+	sprintf(tmp, "%.240s.tmp", file);
+	if ((fp = fopen(tmp, "w")) == NULL) {
+		printf("*** can't open %s\n", tmp);
+		return(1);
+	}
+
+	GAUGE("m37_up", "Statistics of the device read (1) or not (0)");
+	for (d=0; d<nDev; d++)
+		VALUE("m37_up", d, "%d", (int)dev[d].up);
+
+	for (n=0; n<CNT_NUM; n++) {
+		fprintf(fp, "# HELP %s %s\n# TYPE %s counter\n",
+				G_cnt[n][0], G_cnt[n][1], G_cnt[n][0]);
+		for (d=0; d<nDev; d++)
+			if (dev[d].valid)
+				VALUE(G_cnt[n][0], d, "%.0f", dev[d].total[n]);
+	}
+
+	GAUGE("m37_frames_per_second", "Frames committed per second");
+	for (d=0; d<nDev; d++)
+		if (dev[d].valid)
+			VALUE("m37_frames_per_second", d, "%.1f", dev[d].fps);
+
+	GAUGE("m37_underruns_per_minute", "Underruns per minute");
+	for (d=0; d<nDev; d++)
+		if (dev[d].valid)
+			VALUE("m37_underruns_per_minute", d, "%.1f", dev[d].upm);
+
+	GAUGE("m37_irq_rate", "Interrupt rate measured by the driver [1/s]");
+	for (d=0; d<nDev; d++)
+		if (dev[d].valid)
+			VALUE("m37_irq_rate", d, "%lu", dev[d].last.irqRate);
+
+	GAUGE("m37_buffer_fill_bytes", "Output buffer fill");
+	for (d=0; d<nDev; d++)
+		if (dev[d].valid)
+			VALUE("m37_buffer_fill_bytes", d, "%lu", dev[d].last.bufFill);
+
+	GAUGE("m37_buffer_fill_max_bytes", "Max. output buffer fill");
+	for (d=0; d<nDev; d++)
+		if (dev[d].valid)
+			VALUE("m37_buffer_fill_max_bytes", d, "%lu", dev[d].last.fillMax);
+
+	GAUGE("m37_buffer_size_bytes", "Output buffer size");
+	for (d=0; d<nDev; d++)
+		if (dev[d].valid)
+			VALUE("m37_buffer_size_bytes", d, "%lu", dev[d].last.bufSize);
+
+	GAUGE("m37_write_time_max_ms", "Max. M37_BlockWrite time");
+	for (d=0; d<nDev; d++)
+		if (dev[d].valid)
+			VALUE("m37_write_time_max_ms", d, "%lu", dev[d].last.waitMax);
+
+	GAUGE("m37_power_ok", "Power supply to the analog circuit");
+	for (d=0; d<nDev; d++)
+		if (dev[d].valid)
+			VALUE("m37_power_ok", d, "%lu", dev[d].last.pwr);
+
+#undef GAUGE
+#undef VALUE
+
+	/* rename replaces the file atomically where supported */
+	if (fclose(fp) ||
+		(rename(tmp, file) && (remove(file), rename(tmp, file)))) {
+		printf("*** can't write %s\n", file);
+		return(1);
+	}
+	return(0);
+}
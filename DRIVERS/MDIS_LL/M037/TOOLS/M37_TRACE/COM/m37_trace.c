@@ -0,0 +1,305 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                      M37_TRACE                     ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ls
+ *
+ *  Description: Read the M37 driver trace ring and convert it to
+ *               Chrome/Perfetto trace event JSON
+ *
+ *               Without -m the records currently in the trace ring are
+ *               read (post-mortem). With -m the event mask is set and
+ *               records are collected for the given time.
+ *               The JSON file can be loaded in chrome://tracing or
+ *               ui.perfetto.dev.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2010-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/m37_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define REC_NUMBER			256			/* records per read */
+#define POLL_MS				100			/* read interval [msec] */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintError(char *info);
+static int32 ReadRecords(MDIS_PATH path, FILE *fp, double usPerTick);
+static void PrintRecord(FILE *fp, M37_TRACE_REC *recP, double usPerTick);
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const char *G_evName[M37_TRC_NUM] = {
+	"write", "blockwrite", "irq", "underrun", "commit", "config", "power"
+};
+static u_int32	G_nRec;				/* records written */
+static u_int32	G_nextSeq;			/* expected sequence number */
+static u_int32	G_lost;				/* lost records */
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m37_trace [<opts>] <device> [<opts>]\n"                  );
+	printf("Function: Convert M37 driver trace to Chrome/Perfetto JSON\n"	);
+	printf("Options:\n"														);
+	printf("    device       device name .......................... [none]\n");
+	printf("    -m=<mask>    set event mask (hex) and collect ..... [no]\n"	);
+	printf("                  bit 0 = write        bit 4 = commit\n");
+	printf("                  bit 1 = blockwrite   bit 5 = config\n");
+	printf("                  bit 2 = irq          bit 6 = power\n");
+	printf("                  bit 3 = underrun\n");
+	printf("    -n=<sec>     collect time with -m [sec] ........... [10]\n");
+	printf("    -o=<file>    output file .......................... [stdout]\n");
+	printf("\n");
+	printf("Copyright 2010-2019, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_nRec, G_lost
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH	path=0;
+	int32	n, sec, rate, ret=1;
+	u_int32	start;
+	double	usPerTick;
+	FILE	*fp = stdout;
+    char	*device,*str,*errstr, buf[40];
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("m=n=o=?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	if (!device) {
+		usage();
+		return(1);
+	}
+
+	sec = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 10);
+
+	/*--------------------+
+    |  open path          |
+    +--------------------*/
+	if ((path = M_open(device)) < 0) {
+		PrintError("open");
+		return(1);
+	}
+
+	if ((M_getstat(path, M37_TRACE_RATE, &rate)) < 0) {
+		PrintError("getstat M37_TRACE_RATE");
+		goto abort;
+	}
+	usPerTick = 1e6 / rate;
+
+	if ((str = UTL_TSTOPT("o="))) {
+		if ((fp = fopen(str, "w")) == NULL) {
+			printf("*** can't open %s\n", str);
+			goto abort;
+		}
+	}
+
+	/*--------------------+
+    |  read trace         |
+    +--------------------*/
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (n=0; n<M37_TRC_NUM; n++)			/* one track per event */
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+				"\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+				n ? ",\n" : "", n, G_evName[n]);
+
+	if ((str = UTL_TSTOPT("m="))) {
+		/* set mask (clears ring) and collect */
+		if ((M_setstat(path, M37_TRACE_MASK, strtoul(str, NULL, 16))) < 0) {
+			PrintError("setstat M37_TRACE_MASK");
+			goto abort;
+		}
+		start = UOS_MsecTimerGet();
+		do {
+			UOS_Delay(POLL_MS);
+			if (ReadRecords(path, fp, usPerTick))
+				goto abort;
+		} while (UOS_MsecTimerGet() - start < (u_int32)sec * 1000 &&
+				 UOS_KeyPressed() == -1);
+	}
+	else {
+		/* post-mortem: current ring content */
+		if (ReadRecords(path, fp, usPerTick))
+			goto abort;
+	}
+	fprintf(fp, "\n]}\n");
+
+	fprintf(stderr, "%lu records, %lu lost\n", G_nRec, G_lost);
+	ret = 0;
+
+	/*--------------------+
+    |  cleanup            |
+    +--------------------*/
+	abort:
+	if (fp != stdout && fp != NULL)
+		fclose(fp);
+
+	if (M_close(path) < 0)
+		PrintError("close");
+
+	return(ret);
+}
+
+/********************************* ReadRecords ******************************
+ *
+ *  Description: Read all records from the trace ring and print them
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: path		path number
+ *               fp			output file
+ *               usPerTick	trace tick [usec]
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_nextSeq, G_lost
+ ****************************************************************************/
+static int32 ReadRecords(
+	MDIS_PATH path,
+	FILE *fp,
+	double usPerTick
+)
+{
+	M37_TRACE_REC	rec[REC_NUMBER];
+	M_SG_BLOCK		blk;
+	int32			n, nbr;
+
+	do {
+		blk.size = sizeof(rec);
+		blk.data = (void*)rec;
+		if ((M_getstat(path, M37_BLK_TRACE, (int32*)&blk)) < 0) {
+			PrintError("getstat M37_BLK_TRACE");
+			return(1);
+		}
+		nbr = blk.size / sizeof(M37_TRACE_REC);
+
+		for (n=0; n<nbr; n++) {
+			if (G_nRec && rec[n].seq != G_nextSeq)		/* overwritten */
+				G_lost += rec[n].seq - G_nextSeq;
+			G_nextSeq = rec[n].seq + 1;
+			PrintRecord(fp, &rec[n], usPerTick);
+		}
+	} while (nbr == REC_NUMBER);
+
+	return(0);
+}
+
+/********************************* PrintRecord ******************************
+ *
+ *  Description: Print one record as trace event
+ *
+ *               Commits are printed as counter (output values of
+ *               channel 0 and 1), all other events as instant events.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: fp			output file
+ *               recP		trace record
+ *               usPerTick	trace tick [usec]
+ *  Output.....: -
+ *  Globals....: G_nRec
+ ****************************************************************************/
+static void PrintRecord(
+	FILE *fp,
+	M37_TRACE_REC *recP,
+	double usPerTick
+)
+{
+	const char *name = recP->type < M37_TRC_NUM ?
+		G_evName[recP->type] : "unknown";
+
+	if (recP->type == M37_TRC_COMMIT)
+		fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.1f,\"pid\":0,"
+				"\"tid\":%d,\"args\":{\"ch0\":%d,\"ch1\":%d}}",
+				name, recP->tick * usPerTick, recP->type,
+				(int16)(recP->arg1 & 0xffff), (int16)(recP->arg1 >> 16));
+	else
+		fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.1f,"
+				"\"pid\":0,\"tid\":%d,\"args\":{\"seq\":%lu,\"arg0\":%u,"
+				"\"arg1\":%lu}}",
+				name, recP->tick * usPerTick, recP->type,
+				recP->seq, recP->arg0, recP->arg1);
+	G_nRec++;
+}
+
+/********************************* PrintError ********************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+
+static void PrintError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
@@ -39,7 +39,142 @@
 /*-----------------------------------------+
 |  TYPEDEFS                                |
 +-----------------------------------------*/
-/* none */
+/* setpoint schedule entry (M37_BLK_SCHED) */
+typedef struct {
+	u_int32	time;			/* due time [M37_SCHED_CLK units] */
+	u_int32	chMask;			/* channels to update (bit 0..3) */
+	u_int16	val[4];			/* values for channel 0..3 */
+} M37_SCHED_ENTRY;
+
+/* lateness of an applied schedule entry (M37_BLK_SCHED_LATE) */
+typedef struct {
+	u_int32	time;			/* due time of the entry */
+	u_int32	late;			/* lateness [M37_SCHED_CLK units] */
+} M37_SCHED_LATE;
+
+/* ramp of the current channel (M37_BLK_RAMP) */
+typedef struct {
+	u_int32	target;			/* target value (lower word) */
+	u_int32	steps;			/* duration [clock ticks] or 0 */
+	u_int32	maxStep;		/* max. step per clock tick (steps=0) */
+} M37_RAMP;
+
+/* trace record (M37_BLK_TRACE) */
+typedef struct {
+	u_int32	tick;			/* system tick (M37_TRACE_RATE, 1..10ms) */
+	u_int32	seq;			/* sequence number (gaps = lost records) */
+	u_int16	type;			/* event (M37_TRC_xxx) */
+	u_int16	arg0;			/* event argument 0 */
+	u_int32	arg1;			/* event argument 1 */
+} M37_TRACE_REC;
+
+/* committed output frame (M37_BlockRead) */
+typedef struct {
+	u_int32	seq;			/* commit number (gaps = overwritten) */
+	u_int32	tick;			/* system tick (M37_TRACE_RATE) */
+	u_int16	val[4];			/* values of channel 0..3 */
+} M37_HIST_REC;
+
+/* commit timestamp (M37_BLK_TSTAMP) */
+typedef struct {
+	u_int32	seq;			/* commit number (as M37_HIST_REC.seq) */
+	u_int32	ts;				/* time of update strobe (M37_TS_RATE) */
+} M37_TS_REC;
+
+/* stream output position (M37_BLK_POSITION) */
+typedef struct {
+	u_int32	frames;			/* stream frames output (monotonic) */
+	u_int32	queued;			/* stream frames queued (M37_FMT_RAW) */
+	u_int32	queuedBytes;	/* bytes queued */
+	u_int32	seq;			/* commit number of last stream frame */
+	u_int32	commits;		/* commits (next commit number) */
+	u_int32	upFactor;		/* M37_UPSAMPLE */
+	u_int32	upPhase;		/* output frame within stream frame */
+	u_int32	tick;			/* system tick (M37_TRACE_RATE) */
+	u_int32	fillValid;		/* queued, queuedBytes valid (0 while
+							   M37_BlockWrite writes to MBUF) */
+} M37_POSITION;
+
+/* stream configuration (M37_BLK_CONFIG) */
+typedef struct {
+	u_int32	valid;			/* fields to set (M37_CFG_xxx) */
+	u_int32	bufMode;		/* M_BUF_WR_MODE */
+	u_int32	bufTout;		/* M_BUF_WR_TIMEOUT */
+	u_int32	bufLow;			/* M_BUF_WR_LOWWATER */
+	u_int32	sigLow;			/* M_BUF_WR_SIGSET_LOW signal (0=remove) */
+	u_int32	extTrig;		/* M37_EXT_TRIG */
+	u_int32	irqEn;			/* driver interrupt flag (M_MK_IRQ_ENABLE) */
+	u_int32	drvRing;		/* M37_DRV_RING */
+	u_int32	fmt;			/* M37_STREAM_FMT */
+} M37_CONFIG;
+
+/* sequencer segment (M37_BLK_SEQ_SEG), followed by frames x 4 values */
+typedef struct {
+	u_int32	seg;			/* segment 0..M37_SEQ_SEGS-1 */
+	u_int32	frames;			/* number of frames (0=delete) */
+	u_int32	repeat;			/* passes before 'next' (0=endless) */
+	int32	next;			/* next segment or M37_SEQ_NONE (stop) */
+	int32	branch;			/* branch segment or M37_SEQ_NONE */
+} M37_SEQ_SEG;
+
+/* module identification (M37_BLK_ID_INFO) */
+typedef struct {
+	u_int16	magic;			/* ID PROM magic word (0x5346) */
+	u_int16	modId;			/* M-Module ID */
+	u_int16	revision;		/* module revision */
+	u_int16	serial;			/* serial number */
+	u_int16	csum;			/* checksum of ID PROM image (M37_ID_CSUM) */
+	u_int16	res;			/* reserved */
+	char	pldIdent[80];	/* PLD ident string (truncated) */
+	u_int16	data[64];		/* ID PROM image */
+} M37_ID_INFO;
+
+/* driver statistics (M37_BLK_STATS), version M37_STATS_VERSION */
+typedef struct {
+	u_int32	version;		/* M37_STATS_VERSION */
+	u_int32	size;			/* size of returned structure [bytes] */
+	u_int32	tick;			/* system tick of snapshot */
+	u_int32	tickRate;		/* system tick rate [1/s] */
+	/* counters since reset */
+	u_int32	irqs;			/* interrupts */
+	u_int32	commits;		/* frames committed (update strobes) */
+	u_int32	underruns;		/* interrupts with empty output buffer */
+	u_int32	pwrFails;		/* power supply failures */
+	u_int32	batchSwitches;	/* switches of batch service */
+	u_int32	batchSaved;		/* buffer accesses saved by batch service */
+	u_int32	bytesIn;		/* bytes written to output buffer */
+	u_int32	bytesOut;		/* bytes taken from output buffer */
+	/* maxima since reset */
+	u_int32	fillMax;		/* max. output buffer fill [bytes] */
+	u_int32	waitMax;		/* max. M37_BlockWrite time [msec] */
+	u_int32	lateMax;		/* M37_SCHED_LATE_MAX (not reset) */
+	/* state */
+	u_int32	bufMode;		/* M_BUF_WR_MODE */
+	u_int32	bufSize;		/* output buffer size [bytes] */
+	u_int32	bufFill;		/* output buffer fill [bytes] */
+	u_int32	pwr;			/* M37_PWR_SUPPL (from status snapshot) */
+	u_int32	pwrFail;		/* power supply failure latched */
+	u_int32	extTrig;		/* M37_EXT_TRIG */
+	u_int32	irqEn;			/* M_MK_IRQ_ENABLE */
+	u_int32	drvRing;		/* M37_DRV_RING */
+	u_int32	fmt;			/* M37_STREAM_FMT */
+	u_int32	upFactor;		/* M37_UPSAMPLE */
+	u_int32	schedClk;		/* M37_SCHED_CLK */
+	u_int32	schedCount;		/* M37_SCHED_COUNT */
+	int32	seqCur;			/* M37_SEQ_START */
+	u_int32	batchOn;		/* M37_BATCH_STATE */
+	u_int32	irqRate;		/* M37_IRQ_RATE */
+	/* version 2 */
+	u_int32	pwrRecovers;	/* power failure recoveries (since reset) */
+	u_int32	pwrRcvMax;		/* max. recovery downtime [msec] (since reset) */
+} M37_STATS;
+
+/* bus access counters per path (M37_BLK_BUS_STAT) */
+#define M37_BUS_PATHS          5	/* number of paths M37_BUS_xxx */
+typedef struct {
+	u_int32	rd[M37_BUS_PATHS];	/* bus reads of path M37_BUS_xxx */
+	u_int32	wr[M37_BUS_PATHS];	/* bus writes of path M37_BUS_xxx */
+} M37_BUS_STAT;
 
 /*-----------------------------------------+
 |  DEFINES                                 |
@@ -47,6 +182,140 @@
 /* M37 specific status codes (STD) */        /* S,G: S=setstat, G=getstat */
 #define M37_EXT_TRIG           M_DEV_OF+0x00 /* G,S: defines the sampling mode */
 #define M37_PWR_SUPPL          M_DEV_OF+0x01 /* G  : power supply to analog circuit*/
+#define M37_SCHED_CLK          M_DEV_OF+0x02 /* G,S: clock of setpoint schedule */
+#define M37_SCHED_TIME         M_DEV_OF+0x03 /* G  : current schedule time */
+#define M37_SCHED_RATE         M_DEV_OF+0x04 /* G  : schedule clock rate [1/s] */
+#define M37_SCHED_COUNT        M_DEV_OF+0x05 /* G  : number of queued entries */
+#define M37_SCHED_CLR          M_DEV_OF+0x06 /*   S: discard queued entries */
+#define M37_SCHED_LATE_MAX     M_DEV_OF+0x07 /* G,S: max. lateness of entries */
+#define M37_SLEW_LIMIT         M_DEV_OF+0x08 /* G,S: slew limit of current channel */
+#define M37_RAMP_STOP          M_DEV_OF+0x09 /*   S: stop ramp of current channel */
+#define M37_RAMP_STATE         M_DEV_OF+0x0a /* G  : ramp of current channel active */
+#define M37_UPSAMPLE           M_DEV_OF+0x0b /* G,S: upsampling factor of buffered output */
+#define M37_UPSAMPLE_MODE      M_DEV_OF+0x0c /* G,S: interpolation of upsampling */
+#define M37_STREAM_FMT         M_DEV_OF+0x0d /* G,S: format of buffered output data */
+#define M37_DRV_RING           M_DEV_OF+0x0e /* G,S: driver ring instead of MBUF */
+#define M37_RING_FILL          M_DEV_OF+0x0f /* G  : bytes queued in driver ring */
+#define M37_RING_SIZE          M_DEV_OF+0x10 /* G  : size of driver ring */
+#define M37_RING_LOWWATER      M_DEV_OF+0x11 /* G,S: lowwater level of driver ring */
+#define M37_RING_SIGSET_LOW    M_DEV_OF+0x12 /*   S: install ring lowwater signal */
+#define M37_RING_SIGCLR_LOW    M_DEV_OF+0x13 /*   S: remove ring lowwater signal */
+#define M37_STAT_MAXAGE        M_DEV_OF+0x14 /* G,S: max. age of status snapshot */
+#define M37_PWR_SIGSET         M_DEV_OF+0x15 /*   S: install power supply signal */
+#define M37_PWR_SIGCLR         M_DEV_OF+0x16 /*   S: remove power supply signal */
+#define M37_TRACE_MASK         M_DEV_OF+0x17 /* G,S: traced events (bit mask) */
+#define M37_TRACE_RATE         M_DEV_OF+0x18 /* G  : trace tick rate [1/s] */
+#define M37_ACCESS_D32         M_DEV_OF+0x19 /* G  : D32 data register access (ACCESS_D32) */
+#define M37_BUS_STAT_CLR       M_DEV_OF+0x1a /*   S: clear bus access counters */
+#define M37_SEQ_START          M_DEV_OF+0x1b /* G,S: start/stop sequencer, current segment */
+#define M37_SEQ_BRANCH         M_DEV_OF+0x1c /* G,S: request sequencer branch */
+#define M37_SEQ_POS            M_DEV_OF+0x1d /* G  : frame in current segment */
+#define M37_SEQ_PASS           M_DEV_OF+0x1e /* G  : passes of current segment */
+#define M37_CH_OWN             M_DEV_OF+0x1f /* G,S: channels owned by path */
+#define M37_BATCH_RATE         M_DEV_OF+0x20 /* G,S: irq rate for batch service */
+#define M37_BATCH_STATE        M_DEV_OF+0x21 /* G  : batch service active */
+#define M37_BATCH_SWITCHES     M_DEV_OF+0x22 /* G  : batch service switches */
+#define M37_BATCH_SAVED        M_DEV_OF+0x23 /* G  : saved buffer accesses */
+#define M37_IRQ_RATE           M_DEV_OF+0x24 /* G  : measured irq rate [1/s] */
+#define M37_DECIM              M_DEV_OF+0x25 /* G,S: decimation factor of current channel */
+#define M37_ID_CSUM            M_DEV_OF+0x26 /* G  : checksum of cached ID PROM image */
+#define M37_ID_RELOAD          M_DEV_OF+0x27 /*   S: read ID PROM into cache again */
+#define M37_TS_DIV             M_DEV_OF+0x28 /* G,S: timestamp every Nth commit (0=off) */
+#define M37_TS_RATE            M_DEV_OF+0x29 /* G  : timestamp rate [1/s] */
+#define M37_TS_LOST            M_DEV_OF+0x2a /* G  : overwritten timestamps */
+#define M37_PWR_RECOVER        M_DEV_OF+0x2b /* G,S: power failure recovery mode */
+#define M37_PWR_RCV_COUNT      M_DEV_OF+0x2c /* G  : power failure recoveries */
+#define M37_PWR_RCV_TIME       M_DEV_OF+0x2d /* G  : downtime of last recovery [msec] */
+#define M37_LOW_MARGIN         M_DEV_OF+0x2e /* G,S: adaptive lowwater margin (0=off) */
+#define M37_LOW_MAX            M_DEV_OF+0x2f /* G,S: max. adaptive lowwater level */
+#define M37_LOW_LEVEL          M_DEV_OF+0x30 /* G  : effective lowwater level */
+#define M37_LOW_REACT          M_DEV_OF+0x31 /* G  : last refill reaction time [msec] */
+
+/* M37 specific status codes (BLK) */       /* S,G: S=setstat, G=getstat */
+#define M37_BLK_SCHED          M_DEV_BLK_OF+0x00 /*   S: queue schedule entries */
+#define M37_BLK_SCHED_LATE     M_DEV_BLK_OF+0x01 /* G  : lateness of applied entries */
+#define M37_BLK_RAMP           M_DEV_BLK_OF+0x02 /*   S: start ramp of current channel */
+#define M37_BLK_TRACE          M_DEV_BLK_OF+0x03 /* G  : read trace records */
+#define M37_BLK_BUS_STAT       M_DEV_BLK_OF+0x04 /* G  : bus access counters */
+#define M37_BLK_CONFIG         M_DEV_BLK_OF+0x05 /* G,S: stream configuration */
+#define M37_BLK_SEQ_SEG        M_DEV_BLK_OF+0x06 /*   S: load sequencer segment */
+#define M37_BLK_ID_INFO        M_DEV_BLK_OF+0x07 /* G  : module identification */
+#define M37_BLK_STATS          M_DEV_BLK_OF+0x08 /* G  : statistics snapshot */
+#define M37_BLK_STATS_CLR      M_DEV_BLK_OF+0x09 /* G  : statistics snapshot, reset */
+#define M37_BLK_TSTAMP         M_DEV_BLK_OF+0x0a /* G  : read commit timestamps */
+#define M37_BLK_POSITION       M_DEV_BLK_OF+0x0b /* G  : stream output position */
+
+/* schedule clocks (M37_SCHED_CLK) */
+#define M37_SCHED_CLK_TIMER    0	/* system ticks, driver timer */
+#define M37_SCHED_CLK_TRIG     1	/* conversion triggers (interrupts) */
+
+/* upsampling interpolation (M37_UPSAMPLE_MODE) */
+#define M37_UPS_HOLD           0	/* zero-order hold */
+#define M37_UPS_LINEAR         1	/* linear interpolation */
+#define M37_UPS_FIR            2	/* 4-tap cubic (Catmull-Rom) FIR */
+#define M37_UPS_MAX            32	/* max. upsampling factor */
+
+/* buffered output data formats (M37_STREAM_FMT) */
+#define M37_FMT_RAW            0	/* 4 x 16-bit values per frame */
+#define M37_FMT_DELTA          1	/* 4 x 8-bit signed deltas per frame */
+#define M37_FMT_DECIM          2	/* 16-bit values of the due channels */
+
+/* max. decimation factor (M37_DECIM) */
+#define M37_DECIM_MAX          0xffff
+
+/* M37_FMT_DELTA codes at frame start */
+#define M37_DELTA_KEY          0x80	/* keyframe: 4 x 16-bit values follow */
+#define M37_DELTA_PAD          0x81	/* padding byte, ignored */
+
+/* statistics structure version (M37_STATS.version) */
+#define M37_STATS_VERSION      2
+
+/* power failure recovery (M37_PWR_RECOVER) */
+#define M37_PWR_RCV_OFF        0	/* no re-init, outputs as left by hw */
+#define M37_PWR_RCV_LAST       1	/* re-init, restore last values */
+#define M37_PWR_RCV_SAFE       2	/* re-init, outputs 0V */
+
+/* commit timestamps (M37_BLK_TSTAMP) */
+#define M37_TS_DEPTH           1024	/* records kept */
+
+/* output history (M37_BlockRead) */
+#define M37_HIST_DEPTH         256	/* records kept */
+
+/* sequencer (M37_SEQ_xxx) */
+#define M37_SEQ_SEGS           16	/* number of segments */
+#define M37_SEQ_FRAMES         0x10000	/* max. frames per segment */
+#define M37_SEQ_NONE           (-1)	/* no segment / sequencer stopped */
+#define M37_SEQ_BR_OFF         0	/* no branch pending */
+#define M37_SEQ_BR_END         1	/* branch at end of segment pass */
+#define M37_SEQ_BR_NOW         2	/* branch at next frame */
+
+/* trace events (M37_TRACE_REC.type), mask bit = 1<<type    arg0, arg1 */
+#define M37_TRC_WRITE          0	/* M37_Write                 ch, value */
+#define M37_TRC_BLKWRITE       1	/* M37_BlockWrite            mode, size */
+#define M37_TRC_IRQ            2	/* ISR claimed (1)/rejected (0), status */
+#define M37_TRC_UNDERRUN       3	/* ISR: buffer empty         -, irq count */
+#define M37_TRC_COMMIT         4	/* UD commit       -, chan 0 | chan 1<<16 */
+#define M37_TRC_CONFIG         5	/* M37_SetStat               code, value */
+#define M37_TRC_PWR            6	/* power supply changed      state, status */
+#define M37_TRC_NUM            7	/* number of events */
+
+/* fields of M37_CONFIG (valid) */
+#define M37_CFG_BUFMODE        0x01	/* bufMode */
+#define M37_CFG_BUFTOUT        0x02	/* bufTout */
+#define M37_CFG_BUFLOW         0x04	/* bufLow */
+#define M37_CFG_SIGLOW         0x08	/* sigLow */
+#define M37_CFG_EXTTRIG        0x10	/* extTrig */
+#define M37_CFG_IRQEN          0x20	/* irqEn */
+#define M37_CFG_DRVRING        0x40	/* drvRing */
+#define M37_CFG_FMT            0x80	/* fmt */
+#define M37_CFG_ALL            0xff
+
+/* bus access paths (M37_BUS_STAT) */
+#define M37_BUS_OTHER          0	/* init, exit, status codes */
+#define M37_BUS_WRITE          1	/* M37_Write */
+#define M37_BUS_BLKWRITE       2	/* M37_BlockWrite */
+#define M37_BUS_IRQ            3	/* ISR */
+#define M37_BUS_TIMER          4	/* schedule timer */
 
 /*-----------------------------------------+
 |  PROTOTYPES                              |
@@ -56,9 +325,13 @@
 #ifdef _ONE_NAMESPACE_PER_DRIVER_
 #	define M37_GetEntry		LL_GetEntry
 #else
-	/* variant for swapped access */
-#	ifdef ID_SW
+	/* variants for swapped and D32 access */
+#	if defined(ID_SW) && defined(M37_D32)
+#		define M37_GetEntry		M37_SW_D32_GetEntry
+#	elif defined(ID_SW)
 #		define M37_GetEntry		M37_SW_GetEntry
+#	elif defined(M37_D32)
+#		define M37_GetEntry		M37_D32_GetEntry
 #	endif
 	extern void M37_GetEntry(LL_ENTRY* drvP);
 #endif
@@ -0,0 +1,217 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m37frame.h
+ *
+ *       Author: ls
+ *
+ *  Description: C++17 frame builder for M37 buffered output
+ *               - m37::voltToCode: constexpr volt to code conversion
+ *               - m37::Arena: fixed memory for frame batches
+ *               - m37::FrameBatch: frames of the channels of a mask
+ *               - m37::StaticBatch: FrameBatch with its own memory
+ *
+ *               A FrameBatch packs samples of the channels in Mask into
+ *               M37_FMT_RAW frames (4 words) in caller-owned, arena or
+ *               embedded memory. The other channels get a hold value.
+ *               The pack routine is selected at compile time from the
+ *               mask and the sample type (code or volt). The buffer can
+ *               be passed directly to M_setblock, nothing is allocated
+ *               from the heap.
+ *
+ *               Header only, requires C++17.
+ *
+ *     Required: -
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2010-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M37FRAME_H
+#define _M37FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace m37 {
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+constexpr unsigned FRAME_CH    = 4;					/* channels per frame */
+constexpr size_t   FRAME_BYTES = FRAME_CH * 2;		/* bytes per frame */
+constexpr size_t   BATCH_ALIGN = 64;				/* buffer alignment */
+
+/*-----------------------------------------+
+|  Conversion                              |
++-----------------------------------------*/
+/* output range -10V..+10V, 20V = 0xffff codes (see m37_blkwrite) */
+constexpr uint16_t voltToCode(double volt)
+{
+	double calc = volt * (0xffff / 20.0);
+	calc = calc >= 0 ? calc + 0.5 : calc - 0.5;			/* round */
+	return (uint16_t)(int16_t)(calc > 32767.0 ? 32767.0 :
+							   calc < -32768.0 ? -32768.0 : calc);
+}
+
+/* sample types */
+struct Code { using type = uint16_t; };		/* output codes */
+struct Volt { using type = float; };		/* volts, converted */
+
+/*-----------------------------------------+
+|  Arena                                   |
++-----------------------------------------*/
+/*
+ * Bump allocator over caller memory. Memory is taken with take() and
+ * returned all at once with reset(); nothing is freed individually.
+ */
+class Arena {
+public:
+	Arena(void *mem, size_t size)
+		: base_((uint8_t*)mem), size_(size), used_(0) {}
+
+	void *take(size_t size, size_t align = BATCH_ALIGN)
+	{
+		size_t off = (((uintptr_t)base_ + used_ + align - 1) & ~(align - 1)) -
+			(uintptr_t)base_;
+		if (off + size > size_)
+			throw std::length_error("m37: arena full");
+		used_ = off + size;
+		return base_ + off;
+	}
+	void reset() { used_ = 0; }
+	size_t used() const { return used_; }
+
+private:
+	uint8_t	*base_;
+	size_t	size_;
+	size_t	used_;
+};
+
+/*-----------------------------------------+
+|  FrameBatch                              |
++-----------------------------------------*/
+template <unsigned Mask, class Sample = Code>
+class FrameBatch {
+	static_assert(Mask != 0 && Mask < (1u << FRAME_CH), "m37: channel mask");
+
+public:
+	using sample_t = typename Sample::type;
+
+	/* number of channels in Mask (samples per frame) */
+	static constexpr unsigned CHANNELS =
+		((Mask >> 0) & 1) + ((Mask >> 1) & 1) + ((Mask >> 2) & 1) +
+		((Mask >> 3) & 1);
+
+	/* batch in caller memory (aligned to BATCH_ALIGN) */
+	FrameBatch(void *mem, size_t bytes)
+		: buf_((uint16_t*)mem), cap_(bytes / FRAME_BYTES), n_(0), hold_{}
+	{
+		if ((uintptr_t)mem & (BATCH_ALIGN - 1))
+			throw std::invalid_argument("m37: unaligned batch memory");
+	}
+
+	/* batch of 'frames' frames in arena memory */
+	FrameBatch(Arena &arena, size_t frames)
+		: FrameBatch(arena.take(frames * FRAME_BYTES), frames * FRAME_BYTES) {}
+
+	/* value of a channel not in Mask */
+	void hold(unsigned ch, uint16_t code) { hold_[ch % FRAME_CH] = code; }
+
+	/* append one frame (CHANNELS samples, ascending channel) */
+	template <class... S>
+	void push(S... s)
+	{
+		static_assert(sizeof...(S) == CHANNELS, "m37: samples per frame");
+		const sample_t v[CHANNELS] = { (sample_t)s... };
+		pack(v, 1);
+	}
+
+	/* append 'frames' frames of interleaved samples; returns frames taken */
+	size_t pack(const sample_t *src, size_t frames)
+	{
+		if (frames > cap_ - n_)
+			frames = cap_ - n_;
+		uint16_t *dst = buf_ + n_ * FRAME_CH;
+
+		if constexpr (Mask == 0xf && std::is_same<Sample, Code>::value) {
+			std::memcpy(dst, src, frames * FRAME_BYTES);	/* 1:1 */
+		}
+		else {
+			for (size_t f=0; f<frames; f++, dst += FRAME_CH,
+					 src += CHANNELS) {
+				unsigned i = 0;
+				packCh<0>(dst, src, i);
+				packCh<1>(dst, src, i);
+				packCh<2>(dst, src, i);
+				packCh<3>(dst, src, i);
+			}
+		}
+		n_ += frames;
+		return frames;
+	}
+
+	void clear() { n_ = 0; }
+
+	const void *data() const { return buf_; }	/* M_setblock buffer */
+	int32_t bytes() const { return (int32_t)(n_ * FRAME_BYTES); }
+	size_t frames() const { return n_; }
+	size_t capacity() const { return cap_; }
+	bool full() const { return n_ == cap_; }
+
+private:
+	/* one channel of a frame, resolved at compile time */
+	template <unsigned Ch>
+	void packCh(uint16_t *dst, const sample_t *src, unsigned &i) const
+	{
+		if constexpr ((Mask >> Ch) & 1) {
+			if constexpr (std::is_same<Sample, Volt>::value)
+				dst[Ch] = voltToCode(src[i++]);
+			else
+				dst[Ch] = src[i++];
+		}
+		else
+			dst[Ch] = hold_[Ch];
+	}
+
+	uint16_t	*buf_;
+	size_t		cap_;					/* capacity [frames] */
+	size_t		n_;						/* frames */
+	uint16_t	hold_[FRAME_CH];		/* values of channels not in Mask */
+};
+
+/*-----------------------------------------+
+|  StaticBatch                             |
++-----------------------------------------*/
+/* FrameBatch with embedded memory for Frames frames */
+template <unsigned Mask, size_t Frames, class Sample = Code>
+class StaticBatch : public FrameBatch<Mask, Sample> {
+public:
+	StaticBatch() : FrameBatch<Mask, Sample>(mem_, sizeof(mem_)) {}
+	StaticBatch(const StaticBatch &) = delete;
+	StaticBatch &operator=(const StaticBatch &) = delete;
+
+private:
+	alignas(BATCH_ALIGN) uint16_t mem_[Frames * FRAME_CH];
+};
+
+} /* namespace m37 */
+
+#endif /* _M37FRAME_H */
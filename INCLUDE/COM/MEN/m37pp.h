@@ -0,0 +1,338 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m37pp.h
+ *
+ *       Author: ls
+ *
+ *  Description: C++17 interface for the M37 driver
+ *               - m37::Device: RAII device path
+ *               - m37::AsyncWriter: asynchronous block submission
+ *
+ *               The AsyncWriter queues the submitted blocks and writes
+ *               them from one I/O thread per writer with M_setblock,
+ *               several queued blocks combined into one call. Producers
+ *               get a future or a completion callback and block only
+ *               while the queue is full.
+ *
+ *               Header only, requires C++17 and a thread library
+ *               (e.g. g++ -std=c++17 -pthread).
+ *
+ *     Required: libraries: mdis_api
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2010-2019, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M37PP_H
+#define _M37PP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/usr_oss.h>
+}
+#include <MEN/m37_drv.h>
+
+namespace m37 {
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+constexpr int32_t FRAME_SIZE = 8;				/* bytes per frame (4 ch.) */
+constexpr int32_t BATCH_SIZE = 0x10000;			/* default max. batch [bytes] */
+constexpr int32_t QUEUE_SIZE = 0x100000;		/* default max. queued [bytes] */
+
+/*-----------------------------------------+
+|  Error                                   |
++-----------------------------------------*/
+/* failed MDIS call (code = MDIS error code) */
+class Error : public std::runtime_error {
+public:
+	Error(const std::string &what, int32_t code)
+		: std::runtime_error(what + ": " + M_errstring(code)), code_(code) {}
+	int32_t code() const { return code_; }
+
+private:
+	int32_t code_;
+};
+
+/*-----------------------------------------+
+|  Device                                  |
++-----------------------------------------*/
+/* open M37 device path, closed by the destructor */
+class Device {
+public:
+	explicit Device(const std::string &name)
+	{
+		if ((path_ = M_open((char*)name.c_str())) < 0)
+			throw Error("M_open " + name, UOS_ErrnoGet());
+	}
+	~Device() { if (path_ >= 0) M_close(path_); }
+
+	Device(const Device &) = delete;
+	Device &operator=(const Device &) = delete;
+	Device(Device &&o) noexcept : path_(std::exchange(o.path_, -1)) {}
+	Device &operator=(Device &&o) noexcept
+	{
+		if (this != &o) {
+			if (path_ >= 0)
+				M_close(path_);
+			path_ = std::exchange(o.path_, -1);
+		}
+		return *this;
+	}
+
+	MDIS_PATH path() const { return path_; }
+
+	void setStat(int32_t code, INT32_OR_64 value)
+	{
+		if (M_setstat(path_, code, value) < 0)
+			throw Error("M_setstat", UOS_ErrnoGet());
+	}
+	int32_t getStat(int32_t code)
+	{
+		int32 value;
+		if (M_getstat(path_, code, &value) < 0)
+			throw Error("M_getstat", UOS_ErrnoGet());
+		return value;
+	}
+	void write(int32_t value)
+	{
+		if (M_write(path_, value) < 0)
+			throw Error("M_write", UOS_ErrnoGet());
+	}
+	/* blocking block write, returns written bytes */
+	int32_t writeBlock(const void *buf, int32_t size)
+	{
+		int32_t n = M_setblock(path_, (u_int8*)buf, size);
+		if (n < 0)
+			throw Error("M_setblock", UOS_ErrnoGet());
+		return n;
+	}
+
+private:
+	MDIS_PATH path_;
+};
+
+/*-----------------------------------------+
+|  AsyncWriter                             |
++-----------------------------------------*/
+/*
+ * Asynchronous buffered output (M_BUF_RINGBUF)
+ *
+ * submit() queues a block (multiple of FRAME_SIZE) and returns at once,
+ * unless more than maxQueued bytes would be queued: then it blocks until
+ * the I/O thread has taken enough blocks. An empty queue always takes a
+ * block, and submit() from a callback never blocks.
+ * The I/O thread combines queued blocks up to maxBatch bytes into one
+ * M_setblock call and continues a short write with the remaining bytes,
+ * so the stream stays frame aligned. Each block completes with its
+ * number of written bytes and an MDIS error code (0 = all bytes
+ * written): the future returns the bytes or throws Error, the callback
+ * gets both. Exceptions thrown by a callback are ignored.
+ * Blocks are written in submission order. The destructor writes the
+ * queued blocks before it returns.
+ */
+class AsyncWriter {
+public:
+	using Callback = std::function<void(int32_t written, int32_t error)>;
+
+	explicit AsyncWriter(Device &dev, int32_t maxBatch = BATCH_SIZE,
+						 int32_t maxQueued = QUEUE_SIZE)
+		: dev_(dev), maxBatch_(maxBatch < FRAME_SIZE ? FRAME_SIZE : maxBatch),
+		  maxQueued_(maxQueued < FRAME_SIZE ? FRAME_SIZE : maxQueued),
+		  thread_([this] { run(); }) {}
+
+	~AsyncWriter()
+	{
+		{
+			std::lock_guard<std::mutex> lk(mtx_);
+			stop_ = true;
+		}
+		cv_.notify_all();
+		thread_.join();
+	}
+
+	AsyncWriter(const AsyncWriter &) = delete;
+	AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+	/* submit block, completion by future */
+	std::future<int32_t> submit(std::vector<u_int16> data)
+	{
+		auto prom = std::make_shared<std::promise<int32_t>>();
+		auto fut = prom->get_future();
+		submit(std::move(data), [prom](int32_t written, int32_t error) {
+			if (error)
+				prom->set_exception(std::make_exception_ptr(
+										Error("M_setblock", error)));
+			else
+				prom->set_value(written);
+		});
+		return fut;
+	}
+
+	/* submit block, completion by callback (called by the I/O thread) */
+	void submit(std::vector<u_int16> data, Callback cb)
+	{
+		int32_t size = (int32_t)data.size() * 2;
+
+		if (data.empty() || size % FRAME_SIZE)
+			throw std::invalid_argument("m37: block not a multiple of frames");
+		{
+			std::unique_lock<std::mutex> lk(mtx_);
+			/* wait for room, not in a callback (would wait for itself) */
+			if (std::this_thread::get_id() != thread_.get_id())
+				space_.wait(lk, [this, size] {
+					return queue_.empty() || queuedBytes_ + size <= maxQueued_;
+				});
+			queuedBytes_ += size;
+			queue_.push_back(Request{std::move(data), std::move(cb)});
+		}
+		cv_.notify_one();
+	}
+
+	/* wait until all submitted blocks have completed */
+	void flush()
+	{
+		std::unique_lock<std::mutex> lk(mtx_);
+		idle_.wait(lk, [this] { return queue_.empty() && !busy_; });
+	}
+
+	/* bytes submitted but not yet written */
+	int32_t queued()
+	{
+		std::lock_guard<std::mutex> lk(mtx_);
+		return queuedBytes_;
+	}
+
+	/* number of M_setblock calls */
+	u_int32 batches() const { return batches_; }
+
+private:
+	struct Request {
+		std::vector<u_int16> data;
+		Callback cb;
+	};
+
+	void run()
+	{
+		std::vector<Request> batch;
+		std::vector<u_int16> buf;
+
+		for (;;) {
+			/* take queued blocks up to maxBatch (at least one) */
+			{
+				std::unique_lock<std::mutex> lk(mtx_);
+				busy_ = false;
+				idle_.notify_all();
+				cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+				if (queue_.empty())
+					return;					/* stopped, all written */
+
+				int32_t size = 0;
+				do {
+					size += (int32_t)queue_.front().data.size() * 2;
+					batch.push_back(std::move(queue_.front()));
+					queue_.pop_front();
+				} while (!queue_.empty() &&
+						 size + (int32_t)queue_.front().data.size() * 2 <=
+						 maxBatch_);
+				queuedBytes_ -= size;
+				busy_ = true;
+				space_.notify_all();
+			}
+
+			/* one M_setblock for all of them */
+			const u_int8 *src;
+			int32_t size;
+			if (batch.size() == 1) {
+				src  = (const u_int8*)batch[0].data.data();
+				size = (int32_t)batch[0].data.size() * 2;
+			}
+			else {
+				buf.clear();
+				for (auto &r : batch)
+					buf.insert(buf.end(), r.data.begin(), r.data.end());
+				src  = (const u_int8*)buf.data();
+				size = (int32_t)buf.size() * 2;
+			}
+
+			/* continue a short write with the rest (keeps frames aligned) */
+			int32_t written = 0;
+			int32_t error = 0;
+			while (written < size) {
+				int32_t n = M_setblock(dev_.path(), (u_int8*)src + written,
+									   size - written);
+				batches_++;
+				if (n <= 0) {
+					error = n < 0 ? UOS_ErrnoGet() : ERR_MBUF_TIMEOUT;
+					break;
+				}
+				written += n;
+			}
+
+			/* complete in order; blocks after a failed write failed */
+			for (auto &r : batch) {
+				int32_t len = (int32_t)r.data.size() * 2;
+				int32_t got = written < len ? written : len;
+				written -= got;
+				if (!r.cb)
+					continue;
+				try {
+					r.cb(got, got == len ? 0 : error);
+				}
+				catch (...) {
+					/* must not end the I/O thread */
+				}
+			}
+			batch.clear();
+		}
+	}
+
+	Device					&dev_;
+	const int32_t			maxBatch_;
+	const int32_t			maxQueued_;
+	std::mutex				mtx_;
+	std::condition_variable	cv_;				/* queue not empty / stop */
+	std::condition_variable	idle_;				/* queue empty, not busy */
+	std::condition_variable	space_;				/* queued bytes taken */
+	std::deque<Request>		queue_;
+	int32_t					queuedBytes_ = 0;
+	bool					busy_ = false;
+	bool					stop_ = false;
+	std::atomic<u_int32>	batches_{0};
+	std::thread				thread_;			/* last: starts run() */
+};
+
+} /* namespace m37 */
+
+#endif /* _M37PP_H */